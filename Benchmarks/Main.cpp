@@ -0,0 +1,41 @@
+﻿#include <cstring>
+#include <string>
+#include <vector>
+
+#include "benchmark/benchmark.h"
+
+/*!
+* Запускает все бенчмарки. Если файл результатов не задан параметром
+* --benchmark_out, результаты дополнительно пишутся в BenchmarkResults.json
+* в текущем каталоге, чтобы их можно было сравнивать между сборками
+* (например, скриптом compare.py из Google Benchmark).
+*/
+int main(int argc, char* argv[])
+{
+    std::vector<char*> arguments(argv, argv + argc);
+    bool is_output_file_set = false;
+    for (int i = 1; i < argc; ++i)
+    {
+        is_output_file_set |= std::strncmp(argv[i], "--benchmark_out=", 16) == 0;
+    }
+
+    std::string output_file_argument = "--benchmark_out=BenchmarkResults.json";
+    std::string output_format_argument = "--benchmark_out_format=json";
+    if (!is_output_file_set)
+    {
+        arguments.push_back(&output_file_argument[0]);
+        arguments.push_back(&output_format_argument[0]);
+    }
+
+    int arguments_count = static_cast<int>(arguments.size());
+    arguments.push_back(nullptr);
+    benchmark::Initialize(&arguments_count, arguments.data());
+    if (benchmark::ReportUnrecognizedArguments(arguments_count, arguments.data()))
+    {
+        return 1;
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    benchmark::Shutdown();
+    return 0;
+}
@@ -0,0 +1,319 @@
+﻿#include <cstring>
+#include <sstream>
+#include <utility>
+
+#include "benchmark/benchmark.h"
+
+#include "SyntheticLog.h"
+
+#include "../UrlStatisticsCollector/UrlStatisticsCollector.h"
+
+namespace
+{
+
+using DomainAndPath = std::pair<StringView, StringView>;
+
+// Возвращает позиции после префиксов всех URL-ов корпуса.
+std::vector<size_t> FindUrlsBegins(
+        const StringView data)
+{
+    const UrlPrefixScanner url_prefix_scanner;
+    std::vector<size_t> urls_begins;
+    for (std::string::size_type position = url_prefix_scanner.Search(data, 0)
+        ; position != std::string::npos
+        ; position = url_prefix_scanner.Search(data, position + 7))
+    {
+        urls_begins.push_back(data[position + 4] == ':' ? position + 7 : position + 8);
+    }
+
+    return urls_begins;
+}
+
+// Выделяет домены и пути так же, как UrlParser.
+std::vector<DomainAndPath> ExtractUrls(
+        const StringView data)
+{
+    std::vector<DomainAndPath> urls;
+    for (const size_t url_begin : FindUrlsBegins(data))
+    {
+        const size_t domain_end = FindSymbolClassSpanEnd<DomainSymbol>(data, url_begin);
+        if (domain_end == url_begin)
+        {
+            continue;
+        }
+
+        const size_t path_end = FindSymbolClassSpanEnd<PathSymbol>(data, domain_end);
+        urls.emplace_back(
+                data.Substring(url_begin, domain_end - url_begin),
+                path_end == domain_end
+                    ? StringView("/", 1)
+                    : data.Substring(domain_end, path_end - domain_end));
+    }
+
+    return urls;
+}
+
+void SetCounters(
+        benchmark::State& state,
+        const size_t bytes_count,
+        const size_t urls_count)
+{
+    state.SetBytesProcessed(state.iterations() * bytes_count);
+    state.SetItemsProcessed(state.iterations() * urls_count);
+    state.counters["peak_rss_mb"] =
+            static_cast<double>(GetPeakResidentSetSize()) / (1 << 20);
+}
+
+size_t ParseCorpus(
+        const std::string& corpus,
+        const size_t approximate_top_capacity = 0)
+{
+    UrlStatistics statistics(approximate_top_capacity);
+    UrlParser url_parser(statistics);
+    url_parser.ProcessBlock(StringView(corpus));
+    return statistics.urls_count;
+}
+
+void SymbolSpanBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+    const StringView data(corpus);
+    const std::vector<size_t> urls_begins = FindUrlsBegins(data);
+
+    for (auto _ : state)
+    {
+        size_t spans_size = 0;
+        for (const size_t url_begin : urls_begins)
+        {
+            const size_t domain_end = FindSymbolClassSpanEnd<DomainSymbol>(data, url_begin);
+            spans_size += FindSymbolClassSpanEnd<PathSymbol>(data, domain_end) - url_begin;
+        }
+
+        benchmark::DoNotOptimize(spans_size);
+    }
+
+    SetCounters(state, corpus.size(), urls_begins.size());
+}
+
+void ParseBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+
+    size_t urls_count = 0;
+    for (auto _ : state)
+    {
+        urls_count = ParseCorpus(corpus);
+    }
+
+    SetCounters(state, corpus.size(), urls_count);
+}
+
+void ParseSyntheticLogBenchmark(
+        benchmark::State& state)
+{
+    SyntheticLogParameters parameters;
+    parameters.size = GetDefaultSyntheticLogSize() / 4;
+    parameters.url_density = state.range(0) / 100.0;
+    parameters.paths_count = static_cast<size_t>(state.range(1));
+    parameters.zipf_exponent = state.range(2) / 100.0;
+    const std::string& corpus = GetSyntheticLog(parameters);
+
+    size_t urls_count = 0;
+    for (auto _ : state)
+    {
+        urls_count = ParseCorpus(corpus);
+    }
+
+    SetCounters(state, corpus.size(), urls_count);
+}
+
+// Разбор логов с разной долей строк с URL-ами. Режим 0 - только разбиение
+// на строки через memchr (нижняя граница), 1 - поиск префикса в каждой
+// строке отдельно, 2 - UrlParser::ProcessBlock с поиском по всему блоку.
+void UrlDensityBenchmark(
+        benchmark::State& state)
+{
+    SyntheticLogParameters parameters;
+    parameters.size = GetDefaultSyntheticLogSize() / 4;
+    parameters.url_density = state.range(0) / 100.0;
+    const std::string& corpus = GetSyntheticLog(parameters);
+    const StringView data(corpus);
+    const UrlPrefixScanner url_prefix_scanner;
+    const int mode = static_cast<int>(state.range(1));
+
+    size_t urls_count = 0;
+    for (auto _ : state)
+    {
+        if (mode == 2)
+        {
+            urls_count = ParseCorpus(corpus);
+            continue;
+        }
+
+        size_t found_count = 0;
+        const char* current = data.Data();
+        const char* const end = data.Data() + data.Size();
+        while (current != end)
+        {
+            const char* line_end = static_cast<const char*>(
+                    std::memchr(current, '\n', end - current));
+            if (line_end == nullptr)
+            {
+                line_end = end;
+            }
+
+            if (mode == 1 &&
+                    url_prefix_scanner.Search(StringView(current, line_end - current), 0) != std::string::npos)
+            {
+                ++found_count;
+            }
+
+            current = line_end == end ? end : line_end + 1;
+        }
+
+        benchmark::DoNotOptimize(found_count);
+    }
+
+    SetCounters(state, corpus.size(), urls_count);
+}
+
+void CountersUpdateBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+    const std::vector<DomainAndPath> urls = ExtractUrls(StringView(corpus));
+
+    for (auto _ : state)
+    {
+        UrlStatistics statistics(static_cast<size_t>(state.range(1)));
+        for (const DomainAndPath& url : urls)
+        {
+            statistics.AddUrl(url.first, url.second);
+        }
+
+        benchmark::DoNotOptimize(statistics.urls_count);
+    }
+
+    SetCounters(state, corpus.size(), urls.size());
+}
+
+void DomainPathsUpdateBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+    const std::vector<DomainAndPath> urls = ExtractUrls(StringView(corpus));
+    const bool are_domain_paths_counted = state.range(1) != 0;
+
+    size_t tables_memory_usage = 0;
+    size_t domain_paths_memory_usage = 0;
+    for (auto _ : state)
+    {
+        UrlStatistics statistics(
+                0, 0, false, false, false, PathNormalization::Disabled, are_domain_paths_counted);
+        for (const DomainAndPath& url : urls)
+        {
+            statistics.AddUrl(url.first, url.second);
+        }
+
+        tables_memory_usage =
+                statistics.domains.GetPeakMemoryUsage() + statistics.paths.GetPeakMemoryUsage();
+        domain_paths_memory_usage = statistics.domain_paths.GetPeakMemoryUsage();
+        benchmark::DoNotOptimize(statistics.urls_count);
+    }
+
+    SetCounters(state, corpus.size(), urls.size());
+    // Память совместной таблицы сравнивается с памятью таблиц доменов и путей.
+    state.counters["tables_mb"] = static_cast<double>(tables_memory_usage) / (1 << 20);
+    state.counters["domain_paths_mb"] = static_cast<double>(domain_paths_memory_usage) / (1 << 20);
+}
+
+void WriteTopNBenchmark(
+        benchmark::State& state)
+{
+    SyntheticLogParameters parameters;
+    parameters.size = GetDefaultSyntheticLogSize() / 4;
+    parameters.url_density = 1;
+    parameters.paths_count = 1000000;
+    const std::string& corpus = GetSyntheticLog(parameters);
+
+    UrlStatistics statistics;
+    UrlParser url_parser(statistics);
+    url_parser.ProcessBlock(StringView(corpus));
+    const size_t size_of_top = static_cast<size_t>(state.range(0));
+
+    // Повторяет UrlStatisticsCollector::WriteTopNElements для путей.
+    std::ostringstream output;
+    for (auto _ : state)
+    {
+        output.str(std::string());
+        std::vector<KeyCountHandle> handles;
+        handles.reserve(statistics.paths.size());
+        for (const auto& entry : statistics.paths)
+        {
+            handles.push_back(KeyCountHandle{StringView(entry.key), entry.count});
+        }
+
+        const auto top_end = SelectTopN(handles, size_of_top);
+        for (auto current = handles.begin(); current != top_end; ++current)
+        {
+            output << current->count << ' ';
+            output.write(current->key.Data(), current->key.Size());
+            output << '\n';
+        }
+
+        benchmark::DoNotOptimize(output.tellp());
+    }
+
+    // Элементами здесь считаются записи таблицы путей.
+    state.SetItemsProcessed(state.iterations() * statistics.paths.size());
+    state.counters["peak_rss_mb"] =
+            static_cast<double>(GetPeakResidentSetSize()) / (1 << 20);
+}
+
+} // namespace
+
+// Первый аргумент: 0 - BigTestFromUnigine, 1 - синтетический лог.
+BENCHMARK(SymbolSpanBenchmark)
+        ->ArgName("corpus")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(ParseBenchmark)
+        ->ArgName("corpus")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+
+// URL-ов на 100 строк, количество различных путей и показатель Ципфа * 100.
+BENCHMARK(ParseSyntheticLogBenchmark)
+        ->ArgNames({"density_pct", "paths", "zipf_pct"})
+        ->ArgsProduct({{1, 25, 100, 400}, {10000}, {100}})
+        ->ArgsProduct({{100}, {1000, 1000000}, {0, 100, 150}})
+        ->Unit(benchmark::kMillisecond);
+
+// URL-ов на 100 строк и режим UrlDensityBenchmark.
+BENCHMARK(UrlDensityBenchmark)
+        ->ArgNames({"density_pct", "mode"})
+        ->ArgsProduct({{0, 1, 10, 100}, {0, 1, 2}})
+        ->Unit(benchmark::kMillisecond);
+
+// Второй аргумент: емкость приближенных счетчиков (0 - точный подсчет).
+BENCHMARK(CountersUpdateBenchmark)
+        ->ArgNames({"corpus", "approx_capacity"})
+        ->ArgsProduct({{0, 1}, {0, 1000}})
+        ->Unit(benchmark::kMillisecond);
+
+// Второй аргумент: 1 - вести совместные счетчики пар (домен, путь).
+BENCHMARK(DomainPathsUpdateBenchmark)
+        ->ArgNames({"corpus", "domain_paths"})
+        ->ArgsProduct({{0, 1}, {0, 1}})
+        ->Unit(benchmark::kMillisecond);
+
+BENCHMARK(WriteTopNBenchmark)
+        ->ArgName("top")
+        ->Arg(10)
+        ->Arg(1000)
+        ->Unit(benchmark::kMillisecond);
@@ -0,0 +1,70 @@
+﻿#include "benchmark/benchmark.h"
+
+#include "SyntheticLog.h"
+
+#include "../UrlStatisticsCollector/UrlStatisticsCollector.h"
+
+namespace
+{
+
+void SubstringSearcherBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+    const StringView data(corpus);
+    SubstringSearcher substring_searcher("http");
+
+    for (auto _ : state)
+    {
+        size_t urls_count = 0;
+        for (std::string::size_type position = substring_searcher.Search(data, 0)
+            ; position != std::string::npos
+            ; position = substring_searcher.Search(data, position + 4))
+        {
+            urls_count += UrlPrefixScanner::IsUrlPrefix(data, position);
+        }
+
+        benchmark::DoNotOptimize(urls_count);
+    }
+
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+void UrlPrefixScannerBenchmark(
+        benchmark::State& state)
+{
+    const std::string& corpus = GetBenchmarkCorpus(static_cast<int>(state.range(0)));
+    const StringView data(corpus);
+    const UrlPrefixScanner url_prefix_scanner(
+            static_cast<InstructionSet>(state.range(1)));
+
+    for (auto _ : state)
+    {
+        size_t urls_count = 0;
+        for (std::string::size_type position = url_prefix_scanner.Search(data, 0)
+            ; position != std::string::npos
+            ; position = url_prefix_scanner.Search(data, position + 7))
+        {
+            ++urls_count;
+        }
+
+        benchmark::DoNotOptimize(urls_count);
+    }
+
+    state.SetBytesProcessed(state.iterations() * corpus.size());
+}
+
+} // namespace
+
+// Первый аргумент: 0 - BigTestFromUnigine, 1 - синтетический лог.
+BENCHMARK(SubstringSearcherBenchmark)
+        ->ArgName("corpus")
+        ->Arg(0)
+        ->Arg(1)
+        ->Unit(benchmark::kMillisecond);
+
+// Второй аргумент: набор инструкций (0 - Scalar, 1 - SSE2, 2 - AVX2).
+BENCHMARK(UrlPrefixScannerBenchmark)
+        ->ArgNames({"corpus", "isa"})
+        ->ArgsProduct({{0, 1}, {0, 1, 2}})
+        ->Unit(benchmark::kMillisecond);
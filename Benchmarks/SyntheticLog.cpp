@@ -0,0 +1,194 @@
+﻿#include "SyntheticLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <tuple>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+
+// Равномерное число из [0, 1), не зависящее от реализации std::uniform_real_distribution.
+double GenerateUniform(
+        std::mt19937_64& generator)
+{
+    return static_cast<double>(generator() >> 11) / 9007199254740992.0;
+}
+
+} // namespace
+
+ZipfDistribution::ZipfDistribution(
+        const size_t ranks_count,
+        const double exponent)
+    : cumulative_probabilities_(std::max<size_t>(ranks_count, 1))
+{
+    double sum = 0;
+    for (size_t i = 0; i < cumulative_probabilities_.size(); ++i)
+    {
+        sum += 1.0 / std::pow(static_cast<double>(i + 1), exponent);
+        cumulative_probabilities_[i] = sum;
+    }
+
+    for (auto& probability : cumulative_probabilities_)
+    {
+        probability /= sum;
+    }
+}
+
+size_t ZipfDistribution::operator()(
+        std::mt19937_64& generator) const
+{
+    const auto rank = std::upper_bound(
+            cumulative_probabilities_.begin(),
+            cumulative_probabilities_.end(),
+            GenerateUniform(generator));
+    return std::min<size_t>(
+            rank - cumulative_probabilities_.begin(),
+            cumulative_probabilities_.size() - 1);
+}
+
+std::string GenerateSyntheticLog(
+        const SyntheticLogParameters& parameters)
+{
+    static const std::string filler =
+            "Mozilla/4.0 (compatible; MSIE 6.0; Windows NT 5.1; SV1; .NET CLR 1.1.4322) ";
+
+    std::mt19937_64 generator(parameters.seed);
+    const ZipfDistribution domains_distribution(
+            parameters.domains_count,
+            parameters.zipf_exponent);
+    const ZipfDistribution paths_distribution(
+            parameters.paths_count,
+            parameters.zipf_exponent);
+    const size_t whole_urls_per_line = static_cast<size_t>(parameters.url_density);
+    const double extra_url_probability =
+            parameters.url_density - static_cast<double>(whole_urls_per_line);
+
+    std::string log;
+    log.reserve(parameters.size + parameters.line_length);
+    std::string line;
+    while (log.size() < parameters.size)
+    {
+        line = "10.0.0." + std::to_string(generator() % 256) +
+                " - - [02/Jan/2003:02:06:41 -0700] \"GET /page/" +
+                std::to_string(generator() % 1000) + " HTTP/1.1\" 200 " +
+                std::to_string(generator() % 100000) + " ";
+
+        const size_t urls_count = whole_urls_per_line +
+                (GenerateUniform(generator) < extra_url_probability ? 1 : 0);
+        for (size_t i = 0; i < urls_count; ++i)
+        {
+            line += "\"http://www.site" + std::to_string(domains_distribution(generator)) +
+                    ".org/wiki/" + std::to_string(paths_distribution(generator)) + "\" ";
+        }
+
+        if (urls_count == 0)
+        {
+            line += "\"-\" ";
+        }
+
+        while (line.size() < parameters.line_length)
+        {
+            line.append(filler, 0, std::min(filler.size(), parameters.line_length - line.size()));
+        }
+
+        line += '\n';
+        log += line;
+    }
+
+    return log;
+}
+
+const std::string& GetSyntheticLog(
+        const SyntheticLogParameters& parameters)
+{
+    using ParametersKey = std::tuple<size_t, size_t, double, size_t, size_t, double, uint64_t>;
+    static std::map<ParametersKey, std::string> logs;
+
+    const ParametersKey key(
+            parameters.size,
+            parameters.line_length,
+            parameters.url_density,
+            parameters.domains_count,
+            parameters.paths_count,
+            parameters.zipf_exponent,
+            parameters.seed);
+    auto log = logs.find(key);
+    if (log == logs.end())
+    {
+        log = logs.emplace(key, GenerateSyntheticLog(parameters)).first;
+    }
+
+    return log->second;
+}
+
+size_t GetDefaultSyntheticLogSize()
+{
+    const char* corpus_size_variable = std::getenv("URL_BENCHMARK_CORPUS_MB");
+    return static_cast<size_t>(
+            corpus_size_variable != nullptr ? std::strtoull(corpus_size_variable, nullptr, 10) : 64) << 20;
+}
+
+const std::string& GetBigTestLog()
+{
+    static const std::string big_test = []
+    {
+        std::ifstream file(
+                std::string(URL_STATISTICS_TEST_DATA_DIRECTORY) + "/BigTestFromUnigine/Input.txt",
+                std::ios::in | std::ios::binary);
+        return std::string(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+    }();
+
+    return big_test;
+}
+
+const std::string& GetBenchmarkCorpus(
+        const int corpus_index)
+{
+    if (corpus_index == 0)
+    {
+        return GetBigTestLog();
+    }
+
+    SyntheticLogParameters parameters;
+    parameters.size = GetDefaultSyntheticLogSize();
+    return GetSyntheticLog(parameters);
+}
+
+size_t GetPeakResidentSetSize()
+{
+#if defined(_WIN32)
+    PROCESS_MEMORY_COUNTERS memory_counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &memory_counters, sizeof(memory_counters)))
+    {
+        return memory_counters.PeakWorkingSetSize;
+    }
+
+    return 0;
+#else
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+    {
+        return 0;
+    }
+
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    // В Linux ru_maxrss измеряется в килобайтах.
+    return static_cast<size_t>(usage.ru_maxrss) << 10;
+#endif
+#endif
+}
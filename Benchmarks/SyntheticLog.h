@@ -0,0 +1,84 @@
+﻿#pragma once
+
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+/*!
+* Параметры синтетического лога. Лог детерминирован: одинаковые параметры
+* всегда дают одинаковые данные.
+*/
+struct SyntheticLogParameters
+{
+    // Размер лога в байтах.
+    size_t size = 64 << 20;
+    // Средняя длина строки без перевода строки. Строки с URL-ами могут быть длиннее.
+    size_t line_length = 160;
+    // Среднее количество URL-ов в строке.
+    double url_density = 0.25;
+    // Количество различных доменов и путей.
+    size_t domains_count = 100;
+    size_t paths_count = 10000;
+    // Показатель распределения Ципфа для выбора домена и пути. 0 - равномерное.
+    double zipf_exponent = 1.0;
+    uint64_t seed = 42;
+};
+
+/*!
+* Распределение Ципфа на рангах [0, ranks_count): вероятность ранга k
+* пропорциональна 1 / (k + 1)^exponent. В отличие от стандартных
+* распределений результат не зависит от реализации стандартной библиотеки.
+*/
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(
+            const size_t ranks_count,
+            const double exponent);
+
+    size_t operator()(
+            std::mt19937_64& generator) const;
+
+private:
+    std::vector<double> cumulative_probabilities_;
+};
+
+/*!
+* Строит синтетический лог в формате combined log: URL-ы вида
+* "http://www.siteN.org/wiki/M" стоят в полях запроса и referer, остаток
+* строки заполняется текстом без URL-ов.
+*/
+std::string GenerateSyntheticLog(
+        const SyntheticLogParameters& parameters);
+
+/*!
+* Возвращает синтетический лог с заданными параметрами. Логи строятся один
+* раз и хранятся до завершения процесса.
+*/
+const std::string& GetSyntheticLog(
+        const SyntheticLogParameters& parameters);
+
+/*!
+* Возвращает размер синтетических логов по умолчанию. Размер в мегабайтах
+* берется из переменной окружения URL_BENCHMARK_CORPUS_MB (по умолчанию 64).
+*/
+size_t GetDefaultSyntheticLogSize();
+
+/*!
+* Возвращает содержимое BigTestFromUnigine/Input.txt.
+*/
+const std::string& GetBigTestLog();
+
+/*!
+* Возвращает корпус для бенчмарков: 0 - BigTestFromUnigine, 1 - синтетический
+* лог с параметрами по умолчанию и размером GetDefaultSyntheticLogSize().
+*/
+const std::string& GetBenchmarkCorpus(
+        const int corpus_index);
+
+/*!
+* Возвращает наибольший объем физической памяти процесса в байтах или 0,
+* если платформа его не сообщает.
+*/
+size_t GetPeakResidentSetSize();
@@ -1,30 +1,279 @@
-#include "UrlStatisticsCollector/UrlStatisticsCollector.cpp"
+#include <chrono>
+#include <iostream>
+#include <thread>
+
+#include "UrlStatisticsCollector/UrlStatisticsCollector.h"
 
 struct CommandLineOptions
 {
     size_t size_of_top = 5;
-    std::string input_file_path = "Input.txt";
+    size_t threads_count = 1;
+    size_t approximate_top_capacity = 0;
+    size_t cardinality_precision = 0;
+    std::vector<std::string> input_file_paths = {"Input.txt"};
     std::string output_file_path ="Output.txt";
+    std::string snapshot_file_path;
+    bool is_asynchronous_reading = false;
+    bool is_domain_case_folded = false;
+    // 0 - без свертки доменов по уровням.
+    size_t domain_level = 0;
+    // 0 - без top-N по глубине путей; пустая строка - без top-N под префиксом.
+    size_t path_depth = 0;
+    std::string path_prefix;
+    bool is_query_parsed = false;
+    PathNormalization path_normalization = PathNormalization::Disabled;
+    bool are_domain_paths_counted = false;
+    // Правила фильтра вида "allow-domain RULE" и файлы с такими правилами.
+    std::vector<std::string> filter_rules;
+    std::vector<std::string> filter_rules_file_paths;
+    bool is_follow_mode = false;
+    size_t refresh_interval_seconds = 5;
+    std::string time_series_file_path;
+    size_t time_bucket_duration = 60;
+    size_t time_windows_count = 60;
+    // Формат телеметрии: пусто - не выводить, "text" или "json".
+    std::string stats_format;
+    size_t stats_interval_seconds = 0;
 };
 
+void WriteTelemetry(
+        const Telemetry& telemetry,
+        const std::string& stats_format)
+{
+    if (stats_format == "json")
+    {
+        telemetry.WriteJson(std::cerr);
+    }
+    else
+    {
+        telemetry.WriteText(std::cerr);
+    }
+}
+
+/*!
+* Записывает все запрошенные результаты: отчет, временной ряд, снимок,
+* оценку погрешности и телеметрию. В режиме слежения вызывается после
+* каждого обновления статистики.
+*/
+void WriteResults(
+        UrlStatisticsCollector& url_statistics_collector,
+        const CommandLineOptions& command_line_options)
+{
+    url_statistics_collector.WriteStatistics(
+            command_line_options.output_file_path,
+            command_line_options.size_of_top);
+
+    if (!command_line_options.time_series_file_path.empty())
+    {
+        url_statistics_collector.WriteTimeSeries(
+                command_line_options.time_series_file_path);
+    }
+
+    if (!command_line_options.snapshot_file_path.empty())
+    {
+        url_statistics_collector.WriteSnapshot(
+                command_line_options.snapshot_file_path);
+    }
+
+    if (command_line_options.approximate_top_capacity != 0)
+    {
+        std::cout <<
+                "approximate counts overestimate by at most: domains " <<
+                url_statistics_collector.GetDomainsMaximumError() <<
+                ", paths " <<
+                url_statistics_collector.GetPathsMaximumError() << std::endl;
+    }
+
+    if (!command_line_options.stats_format.empty())
+    {
+        WriteTelemetry(url_statistics_collector.GetTelemetry(), command_line_options.stats_format);
+    }
+}
+
+const char* GetParameterValue(
+        int argc,
+        char* argv[],
+        int& current_parameter_index)
+{
+    if (current_parameter_index + 1 >= argc)
+    {
+        throw std::invalid_argument(
+                std::string("Missing value for ") + argv[current_parameter_index]);
+    }
+
+    return argv[++current_parameter_index];
+}
+
 CommandLineOptions ParseCommandLine(
         int argc,
         char* argv[])
 {
     CommandLineOptions command_line_options;
+    std::vector<std::string> file_paths;
 
-    if (argc > 1)
+    for (int current_parameter_index = 1
+        ; current_parameter_index < argc
+        ; ++current_parameter_index)
     {
-        size_t current_parameter_index = 1;
         std::string parameter(argv[current_parameter_index]);
         if (parameter == "-n")
         {
             command_line_options.size_of_top =
-                    std::stoi(argv[++current_parameter_index]);
-            ++current_parameter_index;
+                    std::stoi(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--threads")
+        {
+            command_line_options.threads_count =
+                    std::stoi(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--approx-topk")
+        {
+            command_line_options.approximate_top_capacity =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--hll-precision")
+        {
+            command_line_options.cardinality_precision =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--save-snapshot")
+        {
+            command_line_options.snapshot_file_path =
+                    GetParameterValue(argc, argv, current_parameter_index);
+        }
+        else if (parameter == "--fold-domain-case")
+        {
+            command_line_options.is_domain_case_folded = true;
+        }
+        else if (parameter == "--domain-level")
+        {
+            const std::string domain_level =
+                    GetParameterValue(argc, argv, current_parameter_index);
+            command_line_options.domain_level =
+                    domain_level == "registrable" ? registrable_domain_level :
+                    std::stoul(domain_level);
+        }
+        else if (parameter == "--path-depth")
+        {
+            command_line_options.path_depth =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--path-prefix")
+        {
+            command_line_options.path_prefix =
+                    GetParameterValue(argc, argv, current_parameter_index);
+        }
+        else if (parameter == "--query-stats")
+        {
+            command_line_options.is_query_parsed = true;
+        }
+        else if (parameter == "--normalize-paths")
+        {
+            if (command_line_options.path_normalization == PathNormalization::Disabled)
+            {
+                command_line_options.path_normalization = PathNormalization::Enabled;
+            }
         }
-        command_line_options.input_file_path = argv[current_parameter_index++];
-        command_line_options.output_file_path = argv[current_parameter_index++];
+        else if (parameter == "--strip-trailing-slash")
+        {
+            command_line_options.path_normalization =
+                    PathNormalization::EnabledWithoutTrailingSlash;
+        }
+        else if (parameter == "--domain-paths")
+        {
+            command_line_options.are_domain_paths_counted = true;
+        }
+        else if (parameter == "--allow-domain" ||
+                parameter == "--deny-domain" ||
+                parameter == "--allow-path" ||
+                parameter == "--deny-path")
+        {
+            command_line_options.filter_rules.push_back(
+                    parameter.substr(2) + ' ' + GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--filter-rules")
+        {
+            command_line_options.filter_rules_file_paths.push_back(
+                    GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--async-io")
+        {
+            command_line_options.is_asynchronous_reading = true;
+        }
+        else if (parameter == "--follow")
+        {
+            command_line_options.is_follow_mode = true;
+        }
+        else if (parameter == "--refresh-interval")
+        {
+            command_line_options.refresh_interval_seconds =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--time-series")
+        {
+            command_line_options.time_series_file_path =
+                    GetParameterValue(argc, argv, current_parameter_index);
+        }
+        else if (parameter == "--time-bucket")
+        {
+            const std::string time_bucket =
+                    GetParameterValue(argc, argv, current_parameter_index);
+            command_line_options.time_bucket_duration =
+                    time_bucket == "minute" ? 60 :
+                    time_bucket == "hour" ? 3600 :
+                    std::stoul(time_bucket);
+        }
+        else if (parameter == "--time-windows")
+        {
+            command_line_options.time_windows_count =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else if (parameter == "--stats")
+        {
+            command_line_options.stats_format =
+                    GetParameterValue(argc, argv, current_parameter_index);
+            if (command_line_options.stats_format != "text" &&
+                    command_line_options.stats_format != "json")
+            {
+                throw std::invalid_argument("--stats expects text or json");
+            }
+
+            if (!Telemetry::IsEnabled())
+            {
+                throw std::invalid_argument(
+                        "--stats requires a build with URL_STATISTICS_TELEMETRY=ON");
+            }
+        }
+        else if (parameter == "--stats-interval")
+        {
+            command_line_options.stats_interval_seconds =
+                    std::stoul(GetParameterValue(argc, argv, current_parameter_index));
+        }
+        else
+        {
+            file_paths.push_back(parameter);
+        }
+    }
+
+    if (!file_paths.empty())
+    {
+        if (file_paths.size() < 2)
+        {
+            throw std::invalid_argument(
+                    "Usage: UnigineTestTask [-n NNN] [--threads N] [--approx-topk CAPACITY] "
+                    "[--hll-precision P] [--save-snapshot out.snapshot] [--async-io] [--fold-domain-case] "
+                    "[--domain-level registrable|N] [--path-depth N] [--path-prefix /prefix/] [--query-stats] [--domain-paths] "
+                    "[--allow-domain|--deny-domain [*.]DOMAIN] [--allow-path|--deny-path /path[*]] [--filter-rules rules.txt] "
+                    "[--normalize-paths] [--strip-trailing-slash] "
+                    "[--follow [--refresh-interval SECONDS]] "
+                    "[--time-series out_series.txt [--time-bucket minute|hour|SECONDS] [--time-windows N]] "
+                    "[--stats text|json [--stats-interval SECONDS]] in.txt [in2.txt ... | 'logs/*.gz' | @list.txt] out.txt");
+        }
+
+        command_line_options.output_file_path = file_paths.back();
+        file_paths.pop_back();
+        command_line_options.input_file_paths =
+                ExpandInputFilePaths(file_paths);
     }
 
     return command_line_options;
@@ -40,10 +289,78 @@ int main(int argc, char* argv[])
                     argv);
 
         UrlStatisticsCollector url_statistics_collector(
-                command_line_options.input_file_path);
-        url_statistics_collector.WriteStatistics(
-                command_line_options.output_file_path,
-                command_line_options.size_of_top);
+                command_line_options.input_file_paths.front());
+        url_statistics_collector.SetInputFilePaths(
+                command_line_options.input_file_paths);
+        url_statistics_collector.SetThreadsCount(
+                command_line_options.threads_count);
+        url_statistics_collector.SetFileReadMode(
+                command_line_options.is_asynchronous_reading
+                    ? FileReadMode::Asynchronous
+                    : FileReadMode::Mapped);
+        url_statistics_collector.SetDomainCaseFolding(
+                command_line_options.is_domain_case_folded);
+        url_statistics_collector.SetDomainLevel(
+                command_line_options.domain_level);
+        url_statistics_collector.SetPathDepth(
+                command_line_options.path_depth);
+        url_statistics_collector.SetPathPrefix(
+                command_line_options.path_prefix);
+        url_statistics_collector.SetQueryStatistics(
+                command_line_options.is_query_parsed);
+        url_statistics_collector.SetPathNormalization(
+                command_line_options.path_normalization);
+        url_statistics_collector.SetDomainPathCounting(
+                command_line_options.are_domain_paths_counted);
+
+        UrlFilter url_filter;
+        for (const std::string& filter_rule : command_line_options.filter_rules)
+        {
+            url_filter.AddRule(filter_rule);
+        }
+
+        for (const std::string& file_path : command_line_options.filter_rules_file_paths)
+        {
+            url_filter.LoadRules(file_path);
+        }
+
+        url_statistics_collector.SetUrlFilter(std::move(url_filter));
+        url_statistics_collector.SetApproximateTopCapacity(
+                command_line_options.approximate_top_capacity);
+        url_statistics_collector.SetCardinalityPrecision(
+                command_line_options.cardinality_precision);
+        if (!command_line_options.time_series_file_path.empty())
+        {
+            url_statistics_collector.SetTimeWindows(
+                    command_line_options.time_bucket_duration,
+                    command_line_options.time_windows_count,
+                    command_line_options.size_of_top);
+        }
+
+        const std::string& stats_format = command_line_options.stats_format;
+        if (!stats_format.empty() && command_line_options.stats_interval_seconds != 0)
+        {
+            url_statistics_collector.SetTelemetryHandler(
+                    [&stats_format](const Telemetry& telemetry)
+                    {
+                        WriteTelemetry(telemetry, stats_format);
+                    },
+                    command_line_options.stats_interval_seconds);
+        }
+
+        if (command_line_options.is_follow_mode)
+        {
+            // Отчет обновляется, пока процесс не будет остановлен.
+            for (;;)
+            {
+                url_statistics_collector.UpdateStatistics();
+                WriteResults(url_statistics_collector, command_line_options);
+                std::this_thread::sleep_for(
+                        std::chrono::seconds(command_line_options.refresh_interval_seconds));
+            }
+        }
+
+        WriteResults(url_statistics_collector, command_line_options);
     }
     catch (std::invalid_argument& ex)
     {
@@ -0,0 +1,34 @@
+#include <iostream>
+
+#include "UrlStatisticsCollector/UrlStatisticsCollector.h"
+
+int main(int argc, char* argv[])
+{
+    try
+    {
+        if (argc < 3)
+        {
+            throw std::invalid_argument(
+                    "Usage: SnapshotMerger in.snapshot [in2.snapshot ... | 'hours/*.snapshot' | @list.txt] out.snapshot");
+        }
+
+        const std::vector<std::string> snapshot_file_paths =
+                ExpandInputFilePaths(
+                    std::vector<std::string>(argv + 1, argv + argc - 1));
+        MergeSnapshots(
+                snapshot_file_paths,
+                argv[argc - 1]);
+    }
+    catch (std::invalid_argument& ex)
+    {
+        std::cout << "Invalid argument: " << ex.what() << std::endl;
+        return 1;
+    }
+    catch (std::exception& ex)
+    {
+        std::cout << "Unknown exception: " << ex.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
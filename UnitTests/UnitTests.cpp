@@ -1,9 +1,16 @@
-﻿#include <iterator>
+﻿#include <cctype>
+#include <iterator>
 #include <string>
+#include <sstream>
+#include <algorithm>
 
 #include "gtest/gtest.h"
 
-#include "../UrlStatisticsCollector/UrlStatisticsCollector.cpp"
+#include "../UrlStatisticsCollector/UrlStatisticsCollector.h"
+
+#if defined(URL_STATISTICS_HAVE_ZLIB)
+#include <zlib.h>
+#endif
 
 class SomeName
         : public testing::Test
@@ -77,6 +84,324 @@ TEST_F(SomeName, OneUrlTest)
     ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));    
 }
 
+TEST_F(SomeName, DomainCaseFoldingTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "DomainCaseFoldingTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "DomainCaseFoldingTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "DomainCaseFoldingTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetDomainCaseFolding(true);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            5);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Сравнение со сборкой без приведения регистра: домены различаются.
+    url_statistics_collector.SetDomainCaseFolding(false);
+    ASSERT_EQ(10u, url_statistics_collector.Snapshot(0).domains_count);
+}
+
+TEST_F(SomeName, DomainLevelTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "DomainLevelTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "DomainLevelTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "DomainLevelTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetDomainLevel(registrable_domain_level);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            5);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Узлы общих суффиксов разделяются, счетчики уровней суммируются.
+    const std::vector<std::string> domains =
+            {"en.wikipedia.org", "DE.Wikipedia.ORG", "news.bbc.co.uk"};
+    DomainSuffixTrie domain_suffix_trie;
+    domain_suffix_trie.Add(StringView(domains[0]), 2);
+    domain_suffix_trie.Add(StringView(domains[1]), 3);
+    domain_suffix_trie.Add(StringView(domains[2]), 1);
+    ASSERT_EQ(9u, domain_suffix_trie.GetNodes().size());
+
+    std::vector<KeyCountHandle> level = domain_suffix_trie.GetLevel(2);
+    std::sort(level.begin(), level.end(), IsRankedHigher);
+    ASSERT_EQ(2u, level.size());
+    ASSERT_EQ(5u, level[0].count);
+    ASSERT_EQ("wikipedia.org", std::string(level[0].key.Data(), level[0].key.Size()));
+    ASSERT_EQ("co.uk", std::string(level[1].key.Data(), level[1].key.Size()));
+
+    const std::vector<KeyCountHandle> registrable =
+            domain_suffix_trie.GetLevel(registrable_domain_level);
+    ASSERT_EQ(2u, registrable.size());
+    ASSERT_EQ("bbc.co.uk", std::string(registrable[1].key.Data(), registrable[1].key.Size()));
+}
+
+TEST_F(SomeName, PathPrefixTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "PathPrefixTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "PathPrefixTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "PathPrefixTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetPathDepth(1);
+    url_statistics_collector.SetPathPrefix("/wiki/");
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            5);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Слияние деревьев дает те же счетчики, что и добавление путей в одно дерево.
+    PathPrefixTree first;
+    first.Add(StringView(std::string("/w/index.php")));
+    PathPrefixTree second;
+    second.Add(StringView(std::string("/w/api.php")), 2);
+    second.Add(StringView(std::string("/w/index.php")));
+    first.Merge(second);
+
+    StringArena arena;
+    const std::vector<KeyCountHandle> directories =
+            first.GetHandles(first.GetDepthNodes(1), arena);
+    ASSERT_EQ(1u, directories.size());
+    ASSERT_EQ(4u, directories[0].count);
+    ASSERT_EQ("/w/", std::string(directories[0].key.Data(), directories[0].key.Size()));
+    ASSERT_EQ(2u, first.GetChildNodes(StringView(std::string("/w/"))).size());
+    ASSERT_TRUE(first.GetChildNodes(StringView(std::string("/w"))).empty());
+}
+
+TEST_F(SomeName, QueryStatisticsTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "QueryStatisticsTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "QueryStatisticsTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "QueryStatisticsTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetQueryStatistics(true);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            5);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // URL-ы внутри запроса учитываются и без разбора запросов.
+    url_statistics_collector.SetQueryStatistics(false);
+    ASSERT_EQ(7u, url_statistics_collector.Snapshot(0).urls_count);
+}
+
+TEST_F(SomeName, PathNormalizationTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "PathNormalizationTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "PathNormalizationTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "PathNormalizationTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetPathNormalization(PathNormalization::Enabled);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            5);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Количество URL-ов не зависит от нормализации.
+    url_statistics_collector.SetPathNormalization(PathNormalization::Disabled);
+    ASSERT_EQ(10u, url_statistics_collector.Snapshot(0).urls_count);
+}
+
+TEST_F(SomeName, NormalizePathHandlesDotSegmentsAndEscapes)
+{
+    // Длинный префикс проверяет векторную часть поиска мест для нормализации.
+    const std::string long_prefix = "/wikipedia/commons/thumb";
+    const std::vector<std::pair<std::string, std::string>> cases =
+    {
+        {"/", "/"},
+        {"/a/b", "/a/b"},
+        {"/a/./b", "/a/b"},
+        {"/a//b", "/a/b"},
+        {"/a%2Fb", "/a/b"},
+        {"/a%2fb", "/a/b"},
+        {"/a/b/../c", "/a/c"},
+        {"/a/b/..", "/a/"},
+        {"/../a", "/a"},
+        {"/a/.", "/a/"},
+        {"/a/", "/a/"},
+        {"/.hidden", "/.hidden"},
+        {"/%2E%2E/a", "/a"},
+        {"/%7e%zz%4", "/%7E%zz%4"},
+        {"_a/..", ""},
+        {long_prefix + "/x", long_prefix + "/x"},
+        {long_prefix + "//x", long_prefix + "/x"},
+        {long_prefix + "/x%2F", long_prefix + "/x/"},
+    };
+
+    std::vector<char> buffer;
+    for (const auto& current_case : cases)
+    {
+        const StringView normalized =
+                NormalizePath(StringView(current_case.first), PathNormalization::Enabled, buffer);
+        ASSERT_EQ(current_case.second, std::string(normalized.Data(), normalized.Size()))
+                << current_case.first;
+    }
+
+    const std::string directory = "/a/b/";
+    const StringView stripped =
+            NormalizePath(StringView(directory), PathNormalization::EnabledWithoutTrailingSlash, buffer);
+    ASSERT_EQ("/a/b", std::string(stripped.Data(), stripped.Size()));
+    const std::string root = "/";
+    const StringView normalized_root =
+            NormalizePath(StringView(root), PathNormalization::EnabledWithoutTrailingSlash, buffer);
+    ASSERT_EQ("/", std::string(normalized_root.Data(), normalized_root.Size()));
+}
+
+TEST_F(SomeName, DomainPathsTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "DomainPathsTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "DomainPathsTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "DomainPathsTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetDomainPathCounting(true);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            3);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+}
+
+TEST_F(SomeName, DomainPathsMergeRenumbersEntries)
+{
+    // Вторая статистика больше, поэтому при слиянии таблицы меняются местами
+    // и номера записей первой статистики переводятся на новые.
+    UrlStatistics first(0, 0, false, false, false, PathNormalization::Disabled, true);
+    first.AddUrl(StringView(std::string("a.org")), StringView(std::string("/x")));
+    first.AddUrl(StringView(std::string("b.org")), StringView(std::string("/y")));
+
+    UrlStatistics second(0, 0, false, false, false, PathNormalization::Disabled, true);
+    for (const char* const domain : {"c.org", "d.org", "b.org", "a.org"})
+    {
+        for (const char* const path : {"/z", "/y", "/x"})
+        {
+            second.AddUrl(StringView(std::string(domain)), StringView(std::string(path)));
+        }
+    }
+
+    first.Merge(second);
+    ASSERT_EQ(12u, first.domain_paths.size());
+    size_t pairs_count = 0;
+    for (const auto& entry : first.domain_paths)
+    {
+        const StringView domain = first.domains.GetEntry(entry.domain_index).key;
+        const StringView path = first.paths.GetEntry(entry.path_index).key;
+        const bool is_first_pair =
+                (std::string(domain.Data(), domain.Size()) == "a.org" &&
+                    std::string(path.Data(), path.Size()) == "/x") ||
+                (std::string(domain.Data(), domain.Size()) == "b.org" &&
+                    std::string(path.Data(), path.Size()) == "/y");
+        ASSERT_EQ(is_first_pair ? 2u : 1u, entry.count);
+        pairs_count += entry.count;
+    }
+
+    ASSERT_EQ(first.urls_count, pairs_count);
+}
+
+TEST_F(SomeName, UrlFilterMatchesRules)
+{
+    UrlFilter url_filter;
+    ASSERT_TRUE(url_filter.Empty());
+    url_filter.AddRule("allow-domain *.wikipedia.org");
+    url_filter.AddRule("allow-domain example.com");
+    url_filter.DenyDomain("*.de.wikipedia.org");
+    url_filter.DenyPath("/w/*.php");
+    url_filter.DenyPath("/skins*");
+    url_filter.DenyPath("/favicon.ico");
+    url_filter.DenyPath("*.css");
+    url_filter.DenyPath("/a*/x?y.gif");
+
+    const auto is_accepted = [&url_filter](const std::string& domain, const std::string& path)
+    {
+        return url_filter.IsAccepted(StringView(domain), StringView(path));
+    };
+
+    ASSERT_TRUE(is_accepted("en.wikipedia.org", "/wiki/Main_Page"));
+    ASSERT_TRUE(is_accepted("EN.Wikipedia.ORG", "/wiki/Main_Page"));
+    ASSERT_TRUE(is_accepted("wikipedia.org", "/"));
+    ASSERT_TRUE(is_accepted("example.com", "/favicon.ico.txt"));
+    ASSERT_FALSE(is_accepted("www.example.com", "/"));
+    ASSERT_FALSE(is_accepted("notwikipedia.org", "/"));
+    ASSERT_FALSE(is_accepted("de.wikipedia.org", "/"));
+    ASSERT_FALSE(is_accepted("m.de.wikipedia.org", "/"));
+    ASSERT_FALSE(is_accepted("en.wikipedia.org", "/w/index.php"));
+    ASSERT_TRUE(is_accepted("en.wikipedia.org", "/w/index.phpx"));
+    ASSERT_FALSE(is_accepted("en.wikipedia.org", "/skins-1.5/common.css"));
+    ASSERT_FALSE(is_accepted("example.com", "/favicon.ico"));
+    ASSERT_FALSE(is_accepted("example.com", "/style.css"));
+    ASSERT_TRUE(is_accepted("example.com", "/style.css2"));
+    ASSERT_FALSE(is_accepted("example.com", "/ab/xzy.gif"));
+    ASSERT_FALSE(is_accepted("example.com", "/a/b/x-y.gif"));
+    ASSERT_TRUE(is_accepted("example.com", "/ab/xy.gif"));
+    ASSERT_TRUE(is_accepted("example.com", "/b/xzy.gif"));
+
+    ASSERT_THROW(url_filter.AddRule("allow-host example.com"), std::invalid_argument);
+    ASSERT_THROW(url_filter.AddRule("deny-domain ex*ample.com"), std::invalid_argument);
+
+    // Отфильтрованные URL-ы не попадают ни в одну таблицу.
+    UrlStatisticsCollector url_statistics_collector(
+            test_data_path_common_prefix_ + "DomainPathsTest/Input.txt");
+    UrlFilter wikipedia_filter;
+    wikipedia_filter.AllowDomain("*.wikipedia.org");
+    wikipedia_filter.DenyPath("/w/*");
+    url_statistics_collector.SetUrlFilter(std::move(wikipedia_filter));
+    const UrlStatisticsSnapshot snapshot = url_statistics_collector.Snapshot(0);
+    ASSERT_EQ(7u, snapshot.urls_count);
+    ASSERT_EQ(2u, snapshot.domains_count);
+    ASSERT_EQ(2u, snapshot.paths_count);
+}
+
+TEST_F(SomeName, FoldLatinCaseMatchesSymbolFolding)
+{
+    std::string source;
+    for (int code = 0; code < 256; ++code)
+    {
+        source += static_cast<char>(code);
+    }
+
+    for (size_t size = 0; size <= source.size(); size += 7)
+    {
+        std::string destination(size, '\0');
+        FoldLatinCase(StringView(source.data(), size), &destination[0]);
+        for (size_t i = 0; i < size; ++i)
+        {
+            ASSERT_EQ(ToLowerCaseSymbol(source[i]), static_cast<unsigned char>(destination[i]));
+        }
+    }
+}
+
 TEST_F(SomeName, AllCases)
 {
     const std::string input_file_path =
@@ -113,6 +438,837 @@ TEST_F(SomeName, BigTestFromUnigine)
     ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));    
 }
 
+TEST_F(SomeName, BigTestFromUnigineInParallel)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt";
+
+    for (size_t threads_count = 2; threads_count <= 8; threads_count *= 2)
+    {
+        UrlStatisticsCollector url_statistics_collector(
+                input_file_path);
+        url_statistics_collector.SetThreadsCount(threads_count);
+        url_statistics_collector.WriteStatistics(
+                output_file_path,
+                100);
+
+        ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+    }
+}
+
+TEST_F(SomeName, MultipleFilesTest)
+{
+    const std::vector<std::string> input_file_paths =
+    {
+        test_data_path_common_prefix_ + "AllCases/Input.txt",
+        test_data_path_common_prefix_ + "OneUrlTest/Input.txt",
+        test_data_path_common_prefix_ + "EmptyFileTest/Input.txt",
+        test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt"
+    };
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/ExpectedResult.txt";
+
+    for (size_t threads_count = 1; threads_count <= 8; threads_count *= 2)
+    {
+        UrlStatisticsCollector url_statistics_collector(
+                input_file_paths.front());
+        url_statistics_collector.SetInputFilePaths(input_file_paths);
+        url_statistics_collector.SetThreadsCount(threads_count);
+        url_statistics_collector.WriteStatistics(
+                output_file_path,
+                20);
+
+        ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+    }
+}
+
+TEST_F(SomeName, ExpandInputFilePathsReadsPatternsAndLists)
+{
+    // Пути в списке заданы относительно того же каталога, что и test_data_path_common_prefix_.
+    const std::string file_list_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/FileList.txt";
+
+    const std::vector<std::string> expected_input_file_paths =
+    {
+        test_data_path_common_prefix_ + "AllCases/Input.txt",
+        test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt",
+        test_data_path_common_prefix_ + "OneUrlTest/Input.txt",
+        test_data_path_common_prefix_ + "EmptyFileTest/Input.txt",
+        test_data_path_common_prefix_ + "OneUrlTest/Input.txt"
+    };
+    ASSERT_EQ(
+            expected_input_file_paths,
+            ExpandInputFilePaths({
+                test_data_path_common_prefix_ + "AllCases/Input.txt",
+                "@" + file_list_path,
+                test_data_path_common_prefix_ + "[EO]*Test/Input.txt"}));
+}
+
+TEST_F(SomeName, SnapshotsMergeLikeInputFiles)
+{
+    const std::vector<std::string> test_names =
+    {
+        "AllCases",
+        "OneUrlTest",
+        "EmptyFileTest",
+        "BigTestFromUnigine"
+    };
+    const std::string merged_snapshot_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Output.snapshot";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/ExpectedResult.txt";
+
+    std::vector<std::string> snapshot_file_paths;
+    for (const std::string& test_name : test_names)
+    {
+        snapshot_file_paths.push_back(
+                test_data_path_common_prefix_ + test_name + "/Output.snapshot");
+        UrlStatisticsCollector url_statistics_collector(
+                test_data_path_common_prefix_ + test_name + "/Input.txt");
+        url_statistics_collector.WriteSnapshot(snapshot_file_paths.back());
+        ASSERT_TRUE(IsSnapshotFile(snapshot_file_paths.back()));
+    }
+
+    MergeSnapshots(snapshot_file_paths, merged_snapshot_file_path);
+
+    UrlStatisticsCollector url_statistics_collector(merged_snapshot_file_path);
+    url_statistics_collector.WriteStatistics(output_file_path, 20);
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Результат можно записать поверх одного из сливаемых снимков.
+    MergeSnapshots({merged_snapshot_file_path, snapshot_file_paths[2]}, merged_snapshot_file_path);
+    UrlStatisticsCollector(merged_snapshot_file_path).WriteStatistics(output_file_path, 20);
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Снимки и входные файлы можно смешивать.
+    url_statistics_collector.SetInputFilePaths({
+            snapshot_file_paths[0],
+            snapshot_file_paths[1],
+            test_data_path_common_prefix_ + "EmptyFileTest/Input.txt",
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt"});
+    url_statistics_collector.WriteStatistics(output_file_path, 20);
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+
+    // Фильтр URL-ов к снимкам не применяется.
+    UrlFilter url_filter;
+    url_filter.AllowDomain("*.wikipedia.org");
+    url_statistics_collector.SetUrlFilter(std::move(url_filter));
+    ASSERT_THROW(
+            url_statistics_collector.WriteStatistics(output_file_path, 20),
+            std::invalid_argument);
+    url_statistics_collector.SetUrlFilter(UrlFilter());
+
+    // Пары (домен, путь) из снимков не восстанавливаются.
+    url_statistics_collector.SetDomainPathCounting(true);
+    ASSERT_THROW(
+            url_statistics_collector.WriteStatistics(output_file_path, 20),
+            std::invalid_argument);
+    url_statistics_collector.SetDomainPathCounting(false);
+
+    // Параметры запросов в снимках не хранятся.
+    url_statistics_collector.SetQueryStatistics(true);
+    ASSERT_THROW(
+            url_statistics_collector.WriteStatistics(output_file_path, 20),
+            std::invalid_argument);
+    url_statistics_collector.SetQueryStatistics(false);
+
+    // Испорченный снимок не загружается.
+    std::string snapshot_data;
+    {
+        std::ifstream snapshot_file(merged_snapshot_file_path, std::ios::binary);
+        snapshot_data.assign(
+                std::istreambuf_iterator<char>(snapshot_file),
+                std::istreambuf_iterator<char>());
+    }
+
+    snapshot_data[snapshot_data.size() / 2] ^= 1;
+    {
+        std::ofstream snapshot_file(merged_snapshot_file_path, std::ios::binary);
+        snapshot_file << snapshot_data;
+    }
+
+    ASSERT_THROW(
+            SnapshotReader snapshot_reader(merged_snapshot_file_path),
+            std::invalid_argument);
+}
+
+TEST_F(SomeName, UpdateStatisticsReadsOnlyAppendedLines)
+{
+    const std::string followed_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Followed.log";
+    const std::string rotated_file_path = followed_file_path + ".1";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Output.txt";
+
+    const auto read_file = [](const std::string& file_path)
+    {
+        std::ifstream file(file_path, std::ios::binary);
+        return std::string(
+                std::istreambuf_iterator<char>(file),
+                std::istreambuf_iterator<char>());
+    };
+
+    const std::string big_test_input =
+            read_file(test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt");
+    // Первая порция обрывается посреди строки.
+    const size_t first_part_size = big_test_input.size() / 2;
+    std::remove(rotated_file_path.c_str());
+    {
+        std::ofstream followed_file(followed_file_path, std::ios::binary);
+        followed_file << big_test_input.substr(0, first_part_size);
+    }
+
+    UrlStatisticsCollector url_statistics_collector(followed_file_path);
+    ASSERT_EQ(first_part_size, url_statistics_collector.UpdateStatistics());
+    ASSERT_EQ(0u, url_statistics_collector.UpdateStatistics());
+
+    {
+        std::ofstream followed_file(followed_file_path, std::ios::binary | std::ios::app);
+        followed_file << big_test_input.substr(first_part_size);
+    }
+
+    ASSERT_EQ(
+            big_test_input.size() - first_part_size,
+            url_statistics_collector.UpdateStatistics());
+    url_statistics_collector.WriteStatistics(output_file_path, 100);
+    ASSERT_TRUE(AreFilesEqual(
+            output_file_path,
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt"));
+
+    // Ротация: старый файл дописывается после переименования, новый создается заново.
+    ASSERT_EQ(0, std::rename(followed_file_path.c_str(), rotated_file_path.c_str()));
+    {
+        std::ofstream rotated_file(rotated_file_path, std::ios::binary | std::ios::app);
+        rotated_file << read_file(test_data_path_common_prefix_ + "OneUrlTest/Input.txt");
+        std::ofstream followed_file(followed_file_path, std::ios::binary);
+        followed_file << read_file(test_data_path_common_prefix_ + "AllCases/Input.txt") << '\n';
+    }
+
+    url_statistics_collector.UpdateStatistics();
+    url_statistics_collector.WriteStatistics(output_file_path, 20);
+    ASSERT_TRUE(AreFilesEqual(
+            output_file_path,
+            test_data_path_common_prefix_ + "MultipleFilesTest/ExpectedResult.txt"));
+
+    std::remove(followed_file_path.c_str());
+    std::remove(rotated_file_path.c_str());
+}
+
+#if defined(URL_STATISTICS_TELEMETRY)
+TEST_F(SomeName, TelemetryCountsParsedInput)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+    std::ifstream input_file(input_file_path, std::ios::binary);
+    const std::string input(
+            (std::istreambuf_iterator<char>(input_file)),
+            std::istreambuf_iterator<char>());
+
+    for (const size_t threads_count : {1, 3})
+    {
+        UrlStatisticsCollector url_statistics_collector(input_file_path);
+        url_statistics_collector.SetThreadsCount(threads_count);
+        size_t reports_count = 0;
+        url_statistics_collector.SetTelemetryHandler(
+                [&reports_count](const Telemetry&)
+                {
+                    ++reports_count;
+                },
+                0);
+        const UrlStatisticsSnapshot snapshot = url_statistics_collector.Snapshot(1);
+
+        const Telemetry telemetry = url_statistics_collector.GetTelemetry();
+        ASSERT_EQ(input.size(), telemetry.bytes_count);
+        ASSERT_EQ(
+                static_cast<uint64_t>(std::count(input.begin(), input.end(), '\n') +
+                    (input.back() != '\n' ? 1 : 0)),
+                telemetry.lines_count);
+        ASSERT_EQ(snapshot.urls_count, telemetry.urls_count);
+        ASSERT_LE(telemetry.urls_count, telemetry.url_candidates_count);
+        ASSERT_LE(telemetry.urls_count, telemetry.hash_probes_count);
+        ASSERT_LT(0u, telemetry.rehashes_count);
+        ASSERT_LT(0u, telemetry.arena_size);
+        ASSERT_LT(0u, telemetry.GetStageTime(TelemetryStage::Read).calls_count);
+        ASSERT_LT(0u, telemetry.GetStageTime(TelemetryStage::Parse).calls_count);
+        ASSERT_EQ(threads_count > 1 ? 1u : 0u, telemetry.GetStageTime(TelemetryStage::Merge).calls_count);
+        ASSERT_LT(0u, reports_count);
+
+        std::ostringstream json;
+        telemetry.WriteJson(json);
+        ASSERT_NE(
+                std::string::npos,
+                json.str().find(",\"urls\":" + std::to_string(snapshot.urls_count) + ","));
+    }
+
+    // Пул потоков для нескольких файлов тоже сообщает о ходе разбора.
+    UrlStatisticsCollector url_statistics_collector;
+    url_statistics_collector.SetInputFilePaths({input_file_path, input_file_path});
+    url_statistics_collector.SetThreadsCount(2);
+    size_t reports_count = 0;
+    url_statistics_collector.SetTelemetryHandler(
+            [&reports_count](const Telemetry&)
+            {
+                ++reports_count;
+            },
+            0);
+    url_statistics_collector.Snapshot(1);
+    ASSERT_LT(0u, reports_count);
+    ASSERT_EQ(2 * input.size(), url_statistics_collector.GetTelemetry().bytes_count);
+}
+#endif
+
+TEST_F(SomeName, FeedSplitsLinesAcrossBuffers)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Output.txt";
+
+    std::ifstream input_file(input_file_path, std::ios::binary);
+    const std::string input(
+            (std::istreambuf_iterator<char>(input_file)),
+            std::istreambuf_iterator<char>());
+
+    // Порции разного размера, строки рвутся в произвольных местах.
+    const size_t parts_sizes[] = {1, 7, 4096, 13, 65536, 2};
+    UrlStatisticsCollector fed_collector;
+    size_t offset = 0;
+    for (size_t i = 0; offset < input.size(); ++i)
+    {
+        const size_t part_size = std::min(
+                parts_sizes[i % (sizeof(parts_sizes) / sizeof(parts_sizes[0]))],
+                input.size() - offset);
+        fed_collector.Feed(input.data() + offset, part_size);
+        offset += part_size;
+    }
+
+    fed_collector.FinishFeed();
+    fed_collector.WriteStatistics(output_file_path, 100);
+    ASSERT_TRUE(AreFilesEqual(
+            output_file_path,
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt"));
+
+    UrlStatisticsCollector file_collector(input_file_path);
+    const UrlStatisticsSnapshot expected = file_collector.Snapshot(5);
+    const UrlStatisticsSnapshot actual = fed_collector.Snapshot(5);
+    ASSERT_EQ(expected.urls_count, actual.urls_count);
+    ASSERT_EQ(expected.domains_count, actual.domains_count);
+    ASSERT_EQ(expected.paths_count, actual.paths_count);
+    ASSERT_EQ(5u, actual.top_domains.size());
+    ASSERT_EQ(expected.top_paths.size(), actual.top_paths.size());
+    for (size_t i = 0; i < actual.top_domains.size(); ++i)
+    {
+        ASSERT_TRUE(expected.top_domains[i].key == actual.top_domains[i].key);
+        ASSERT_EQ(expected.top_domains[i].count, actual.top_domains[i].count);
+        ASSERT_TRUE(expected.top_paths[i].key == actual.top_paths[i].key);
+        ASSERT_EQ(expected.top_paths[i].count, actual.top_paths[i].count);
+    }
+}
+
+TEST_F(SomeName, TimeSeriesTest)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "TimeSeriesTest/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "TimeSeriesTest/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "TimeSeriesTest/ExpectedResult.txt";
+
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+
+    // В режиме слежения хранятся отчеты только последних закрытых корзин.
+    const auto count_buckets = [&output_file_path]
+    {
+        std::ifstream output_file(output_file_path);
+        size_t buckets_count = 0;
+        for (std::string line; std::getline(output_file, line); )
+        {
+            buckets_count += line.compare(0, 7, "bucket ") == 0;
+        }
+
+        return buckets_count;
+    };
+
+    url_statistics_collector.SetTimeWindows(60, 1, 2);
+    url_statistics_collector.WriteTimeSeries(output_file_path);
+    const size_t batch_buckets_count = count_buckets();
+    url_statistics_collector.UpdateStatistics();
+    url_statistics_collector.WriteTimeSeries(output_file_path);
+    ASSERT_LT(count_buckets(), batch_buckets_count);
+
+    // Минутные корзины, окно из двух корзин: одна строка опаздывает больше
+    // чем на окно, одна строка без времени.
+    url_statistics_collector.SetTimeWindows(60, 2, 2);
+    url_statistics_collector.WriteTimeSeries(
+            output_file_path);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+}
+
+TEST_F(SomeName, FindLineTimestampParsesIsoAndCommonLogFormats)
+{
+    const auto find_timestamp = [](const std::string& line)
+    {
+        int64_t timestamp = -1;
+        return FindLineTimestamp(StringView(line), timestamp)
+                ? FormatTimestamp(timestamp)
+                : std::string();
+    };
+
+    ASSERT_EQ(
+            "2014-01-21T08:36:33",
+            find_timestamp("ssl1001 129960997 2014-01-21T08:36:33.097 0.426 1.2.3.4"));
+    ASSERT_EQ(
+            "2013-09-26T06:28:16",
+            find_timestamp("cp1048.eqiad.wmnet 8883921154 2013-09-26T06:28:16 0.001308203"));
+    // Время Common Log Format приводится к UTC.
+    ASSERT_EQ(
+            "2003-01-02T09:06:41",
+            find_timestamp("62.172.72.131 - - [02/Jan/2003:02:06:41 -0700] \"GET / HTTP/1.0\""));
+    ASSERT_EQ(
+            "2000-02-29T23:30:00",
+            find_timestamp("1.2.3.4 - - [01/Mar/2000:01:00:00 +0130] \"GET / HTTP/1.0\""));
+    ASSERT_EQ(
+            "1969-12-31T23:59:59",
+            find_timestamp("1969-12-31T23:59:59"));
+    ASSERT_EQ("", find_timestamp("2014-13-21T08:36:33"));
+    ASSERT_EQ("", find_timestamp("62.172.72.131 - - [02/Jqn/2003:02:06:41 -0700]"));
+    ASSERT_EQ("", find_timestamp("2014-01-21T08:36"));
+    ASSERT_EQ("", find_timestamp(std::string(300, ' ') + "2014-01-21T08:36:33"));
+}
+
+TEST_F(SomeName, BufferedInputSourceKeepsLinesWhole)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "AllCases/Input.txt";
+
+    FILE* input_file = std::fopen(input_file_path.c_str(), "rb");
+    ASSERT_NE(input_file, nullptr);
+
+    // Буфер заведомо меньше строки, чтобы проверить его расширение.
+    BufferedInputSource buffered_input_source(
+            std::unique_ptr<ByteStream>(new FileByteStream(input_file, true)),
+            7);
+    std::string buffered_data;
+    StringView block;
+    while (buffered_input_source.ReadBlock(block))
+    {
+        buffered_data.append(block.Data(), block.Size());
+    }
+
+    MappedFileInputSource mapped_input_source(input_file_path);
+    ASSERT_TRUE(mapped_input_source.ReadBlock(block));
+    ASSERT_EQ(buffered_data, block.ToString());
+}
+
+TEST_F(SomeName, UrlPrefixScannerMatchesSubstringSearcher)
+{
+    MappedFileInputSource input_source(
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt");
+    StringView data;
+    ASSERT_TRUE(input_source.ReadBlock(data));
+
+    std::vector<std::string::size_type> expected_positions;
+    SubstringSearcher substring_searcher("http");
+    for (std::string::size_type position = substring_searcher.Search(data, 0)
+        ; position != std::string::npos
+        ; position = substring_searcher.Search(data, position + 1))
+    {
+        if (UrlPrefixScanner::IsUrlPrefix(data, position))
+        {
+            expected_positions.push_back(position);
+        }
+    }
+
+    const InstructionSet instruction_sets[] =
+    {
+        InstructionSet::Scalar,
+        InstructionSet::Sse2,
+        InstructionSet::Avx2
+    };
+    for (const InstructionSet instruction_set : instruction_sets)
+    {
+        const UrlPrefixScanner url_prefix_scanner(instruction_set);
+        std::vector<std::string::size_type> positions;
+        for (std::string::size_type position = url_prefix_scanner.Search(data, 0)
+            ; position != std::string::npos
+            ; position = url_prefix_scanner.Search(data, position + 1))
+        {
+            positions.push_back(position);
+        }
+
+        ASSERT_EQ(expected_positions, positions);
+    }
+}
+
+TEST_F(SomeName, CountSymbolMatchesStdCount)
+{
+    // Больше 255 шагов по 16 байтов и неполный хвост.
+    std::string data;
+    for (size_t i = 0; data.size() < 10000; ++i)
+    {
+        data += std::string(i % 7, 'a') + '\n';
+    }
+
+    for (const size_t size : {0, 1, 15, 16, 17, 4080, 4081, 9999})
+    {
+        const std::string part = data.substr(0, size);
+        ASSERT_EQ(
+                static_cast<size_t>(std::count(part.begin(), part.end(), '\n')),
+                CountSymbol(StringView(part), '\n')) << size;
+    }
+}
+
+TEST_F(SomeName, SymbolClassSpanEndMatchesTaskGrammar)
+{
+    const std::string domain_symbols = ".-";
+    const std::string path_symbols = ".,/+_";
+
+    for (int symbol = 0; symbol < 256; ++symbol)
+    {
+        const bool is_letter_or_number = std::isalnum(symbol) != 0;
+        const bool is_domain_symbol = is_letter_or_number ||
+                (symbol != 0 && domain_symbols.find(static_cast<char>(symbol)) != std::string::npos);
+        const bool is_path_symbol = is_letter_or_number ||
+                (symbol != 0 && path_symbols.find(static_cast<char>(symbol)) != std::string::npos);
+        const bool is_query_symbol = std::isgraph(symbol) != 0 &&
+                std::string("\"#<>[\\]^`{|}").find(static_cast<char>(symbol)) == std::string::npos;
+
+        // Проверяемый символ попадает и в векторную часть, и в скалярный хвост.
+        for (const size_t symbol_position : {20, 35})
+        {
+            std::string line(40, 'a');
+            line[symbol_position] = static_cast<char>(symbol);
+
+            ASSERT_EQ(
+                    is_domain_symbol ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<DomainSymbol>(line, 1)) << symbol;
+            ASSERT_EQ(
+                    is_path_symbol ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<PathSymbol>(line, 1)) << symbol;
+            ASSERT_EQ(
+                    is_query_symbol ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<QuerySymbol>(line, 1)) << symbol;
+            ASSERT_EQ(
+                    is_path_symbol || symbol == '%' ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<EscapedPathSymbol>(line, 1)) << symbol;
+            ASSERT_EQ(
+                    is_query_symbol && symbol != '&' && symbol != '=' ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<QueryKeySymbol>(line, 1)) << symbol;
+            ASSERT_EQ(
+                    is_query_symbol && symbol != '&' ? line.size() : symbol_position,
+                    FindSymbolClassSpanEnd<QueryValueSymbol>(line, 1)) << symbol;
+        }
+    }
+}
+
+TEST_F(SomeName, StringCounterTableCountsLikeUnorderedMap)
+{
+    std::unordered_map<std::string, size_t> expected_counts;
+    StringCounterTable counter_table;
+
+    for (size_t i = 0; i < 100000; ++i)
+    {
+        // Ключи разной длины, часть из них длиннее блока арены.
+        const std::string key =
+                "/wiki/" + std::to_string(i * 7919 % 5003) +
+                std::string(i % 1000 == 0 ? 70000 : i % 40, 'x');
+        ++expected_counts[key];
+        counter_table.Increment(key);
+    }
+
+    ASSERT_EQ(expected_counts.size(), counter_table.size());
+    for (const auto& entry : counter_table)
+    {
+        ASSERT_EQ(expected_counts[entry.key.ToString()], entry.count);
+    }
+
+    ASSERT_GT(counter_table.GetPeakMemoryUsage(), expected_counts.size() * sizeof(StringCounterTable::Entry));
+
+    counter_table.clear();
+    ASSERT_TRUE(counter_table.empty());
+}
+
+TEST_F(SomeName, BigTestFromUnigineApproximateWithoutEvictions)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt";
+
+    // Емкости хватает на все ключи, поэтому результат совпадает с точным.
+    UrlStatisticsCollector url_statistics_collector(
+            input_file_path);
+    url_statistics_collector.SetApproximateTopCapacity(10000);
+    url_statistics_collector.WriteStatistics(
+            output_file_path,
+            100);
+
+    ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+    ASSERT_EQ(0u, url_statistics_collector.GetPathsMaximumError());
+}
+
+TEST_F(SomeName, SpaceSavingCounterStaysWithinErrorBounds)
+{
+    std::unordered_map<std::string, size_t> expected_counts;
+    SpaceSavingCounter first_counter(64);
+    SpaceSavingCounter second_counter(64);
+
+    for (size_t i = 0; i < 50000; ++i)
+    {
+        // Распределение с тяжелым хвостом: малые номера встречаются чаще.
+        const std::string key = "/page/" + std::to_string(i % (1 + i % 97));
+        ++expected_counts[key];
+        (i % 2 == 0 ? first_counter : second_counter).Increment(key);
+    }
+
+    first_counter.Merge(second_counter);
+    ASSERT_EQ(50000u, first_counter.GetTotalCount());
+    ASSERT_EQ(64u, first_counter.size());
+    for (const auto& entry : first_counter)
+    {
+        const size_t expected_count = expected_counts[entry.key];
+        ASSERT_LE(expected_count, entry.count);
+        ASSERT_LE(entry.count - entry.error, expected_count);
+    }
+}
+
+TEST_F(SomeName, HyperLogLogEstimatesAndMerges)
+{
+    HyperLogLog whole(14);
+    HyperLogLog first_half(14);
+    HyperLogLog second_half(14);
+
+    const size_t distinct_count = 200000;
+    for (size_t i = 0; i < 2 * distinct_count; ++i)
+    {
+        // Каждый ключ встречается дважды.
+        const std::string key = "/wiki/" + std::to_string(i % distinct_count);
+        whole.Add(key);
+        (i % 3 == 0 ? first_half : second_half).Add(key);
+    }
+
+    first_half.Merge(second_half);
+    ASSERT_EQ(whole.Estimate(), first_half.Estimate());
+    // Стандартная ошибка при точности 14 - около 0.8%, допускаем четыре.
+    ASSERT_NEAR(
+            static_cast<double>(distinct_count),
+            static_cast<double>(whole.Estimate()),
+            distinct_count * 0.032);
+
+    HyperLogLog small(14);
+    for (size_t i = 0; i < 100; ++i)
+    {
+        small.Add(std::to_string(i % 10));
+    }
+
+    ASSERT_EQ(10u, small.Estimate());
+}
+
+TEST_F(SomeName, SelectTopNOrdersLikeLowerCaseComparison)
+{
+    std::vector<std::string> keys;
+    for (size_t i = 0; i < 3000; ++i)
+    {
+        // Пары ключей, различающихся только регистром.
+        std::string key = "/Wiki/" + std::to_string(i / 2);
+        if (i % 2 == 0)
+        {
+            key[1] = 'w';
+        }
+
+        keys.push_back(key);
+    }
+
+    std::vector<KeyCountHandle> handles;
+    for (size_t i = 0; i < keys.size(); ++i)
+    {
+        handles.push_back(KeyCountHandle{StringView(keys[i]), i / 2 % 5});
+    }
+
+    std::vector<KeyCountHandle> expected_handles = handles;
+    std::sort(
+            expected_handles.begin(),
+            expected_handles.end(),
+            [](const KeyCountHandle& left, const KeyCountHandle& right)
+            {
+                if (left.count != right.count)
+                {
+                    return left.count > right.count;
+                }
+
+                std::string left_lower_case = left.key.ToString();
+                std::string right_lower_case = right.key.ToString();
+                std::transform(left_lower_case.begin(), left_lower_case.end(), left_lower_case.begin(), ::tolower);
+                std::transform(right_lower_case.begin(), right_lower_case.end(), right_lower_case.begin(), ::tolower);
+                if (left_lower_case != right_lower_case)
+                {
+                    return left_lower_case < right_lower_case;
+                }
+
+                return left.key.ToString() < right.key.ToString();
+            });
+
+    for (const size_t size_of_top : {0, 1, 100, 2999, 3000, 5000})
+    {
+        std::vector<KeyCountHandle> selected_handles = handles;
+        const auto top_end = SelectTopN(selected_handles, size_of_top);
+        ASSERT_EQ(std::min<size_t>(size_of_top, handles.size()), static_cast<size_t>(top_end - selected_handles.begin()));
+        for (auto current = selected_handles.begin(); current != top_end; ++current)
+        {
+            const KeyCountHandle& expected_handle =
+                    expected_handles[current - selected_handles.begin()];
+            ASSERT_EQ(expected_handle.key.ToString(), current->key.ToString());
+            ASSERT_EQ(expected_handle.count, current->count);
+        }
+    }
+}
+
+TEST_F(SomeName, PipelinedInputSourceKeepsLinesWhole)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+
+    FILE* input_file = std::fopen(input_file_path.c_str(), "rb");
+    ASSERT_NE(input_file, nullptr);
+
+    // Два маленьких буфера: фоновый поток постоянно ждет освобождения буфера.
+    PipelinedInputSource pipelined_input_source(
+            std::unique_ptr<ByteStream>(new FileByteStream(input_file, true)),
+            2,
+            100);
+    std::string pipelined_data;
+    StringView block;
+    while (pipelined_input_source.ReadBlock(block))
+    {
+        ASSERT_EQ('\n', block[block.Size() - 1]);
+        pipelined_data.append(block.Data(), block.Size());
+    }
+
+    ASSERT_FALSE(pipelined_input_source.ReadBlock(block));
+
+    MappedFileInputSource mapped_input_source(input_file_path);
+    ASSERT_TRUE(mapped_input_source.ReadBlock(block));
+    ASSERT_EQ(block.ToString(), pipelined_data);
+}
+
+TEST_F(SomeName, AsynchronousFileInputSourceKeepsLinesWhole)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "MultipleFilesTest/Asynchronous.log";
+
+    std::ifstream big_test_file(
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt",
+            std::ios::binary);
+    // Строка длиннее буфера и последняя строка без перевода строки.
+    const std::string input =
+            std::string(
+                std::istreambuf_iterator<char>(big_test_file),
+                std::istreambuf_iterator<char>()) +
+            "http://long.example.com/" + std::string(1000, 'a') + "\n" +
+            "http://last.example.com/line";
+    {
+        std::ofstream input_file(input_file_path, std::ios::binary);
+        input_file << input;
+    }
+
+    for (const bool is_io_uring_allowed : {true, false})
+    {
+        for (const size_t buffer_size : {100, 4096})
+        {
+            AsynchronousFileInputSource input_source(
+                    input_file_path,
+                    buffer_size == 100 ? 2 : 3,
+                    buffer_size,
+                    is_io_uring_allowed);
+            std::string data;
+            StringView block;
+            while (input_source.ReadBlock(block))
+            {
+                ASSERT_FALSE(block.Empty());
+                data.append(block.Data(), block.Size());
+                if (data.size() != input.size())
+                {
+                    ASSERT_EQ('\n', block[block.Size() - 1]);
+                }
+            }
+
+            ASSERT_FALSE(input_source.ReadBlock(block));
+            ASSERT_EQ(input, data);
+        }
+    }
+
+    std::remove(input_file_path.c_str());
+
+    UrlStatisticsCollector url_statistics_collector(
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt");
+    url_statistics_collector.SetFileReadMode(FileReadMode::Asynchronous);
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Output.txt";
+    url_statistics_collector.WriteStatistics(output_file_path, 100);
+    ASSERT_TRUE(AreFilesEqual(
+            output_file_path,
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt"));
+}
+
+#if defined(URL_STATISTICS_HAVE_ZLIB)
+TEST_F(SomeName, BigTestFromUnigineGzip)
+{
+    const std::string input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt";
+    const std::string compressed_input_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Input.txt.gz";
+    const std::string output_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/Output.txt";
+    const std::string expected_result_file_path =
+            test_data_path_common_prefix_ + "BigTestFromUnigine/ExpectedResult.txt";
+
+    std::ifstream input_file(input_file_path, std::ios::in | std::ios::binary);
+    const std::string input_data(
+            (std::istreambuf_iterator<char>(input_file)),
+            std::istreambuf_iterator<char>());
+
+    // Архив из двух частей, как после склейки ротированных логов. Граница
+    // частей проходит посередине строки.
+    const size_t first_part_size = input_data.size() / 2;
+    const char* const open_modes[] = {"wb", "ab"};
+    for (size_t part = 0; part < 2; ++part)
+    {
+        gzFile compressed_file = gzopen(compressed_input_file_path.c_str(), open_modes[part]);
+        ASSERT_NE(compressed_file, nullptr);
+        const size_t part_begin = part == 0 ? 0 : first_part_size;
+        const size_t part_end = part == 0 ? first_part_size : input_data.size();
+        ASSERT_EQ(
+                static_cast<int>(part_end - part_begin),
+                gzwrite(compressed_file, input_data.data() + part_begin, static_cast<unsigned>(part_end - part_begin)));
+        ASSERT_EQ(Z_OK, gzclose(compressed_file));
+    }
+
+    for (size_t threads_count = 1; threads_count <= 4; threads_count *= 4)
+    {
+        UrlStatisticsCollector url_statistics_collector(
+                compressed_input_file_path);
+        url_statistics_collector.SetThreadsCount(threads_count);
+        url_statistics_collector.WriteStatistics(
+                output_file_path,
+                100);
+
+        ASSERT_TRUE(AreFilesEqual(output_file_path, expected_result_file_path));
+    }
+}
+#endif
+
 int main(int argc, char** argv)
 {
 	testing::InitGoogleTest(&argc, argv);
@@ -0,0 +1,1017 @@
+﻿#pragma once
+
+#include <string>
+#include <algorithm>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <stdexcept>
+
+#include "StringView.h"
+#include "Telemetry.h"
+
+/*!
+* Арена для хранения строк. Память выделяется крупными блоками и
+* освобождается вся сразу.
+*/
+class StringArena
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] block_size Размер блока. Строки длиннее блока получают отдельный блок.
+    */
+    explicit StringArena(
+            const size_t block_size = 1 << 16)
+        : block_size_(block_size)
+        , current_(nullptr)
+        , remaining_size_(0)
+        , allocated_size_(0)
+    {
+    }
+
+    /*!
+    * Копирует строку в арену.
+    *
+    \return Ссылка на копию, действительная до вызова Clear или уничтожения арены.
+    */
+    StringView Store(
+            const StringView data)
+    {
+        if (data.Size() > remaining_size_)
+        {
+            const size_t new_block_size = std::max(block_size_, data.Size());
+            blocks_.emplace_back(new char[new_block_size]);
+            allocated_size_ += new_block_size;
+            if (data.Size() >= block_size_)
+            {
+                // Длинная строка занимает свой блок целиком, текущий блок продолжаем заполнять.
+                std::memcpy(blocks_.back().get(), data.Data(), data.Size());
+                return StringView(blocks_.back().get(), data.Size());
+            }
+
+            current_ = blocks_.back().get();
+            remaining_size_ = new_block_size;
+        }
+
+        char* stored_data = current_;
+        std::memcpy(stored_data, data.Data(), data.Size());
+        current_ += data.Size();
+        remaining_size_ -= data.Size();
+        return StringView(stored_data, data.Size());
+    }
+
+    /*!
+    * Освобождает все блоки разом.
+    */
+    void Clear()
+    {
+        blocks_.clear();
+        current_ = nullptr;
+        remaining_size_ = 0;
+        allocated_size_ = 0;
+    }
+
+    /*!
+    * Возвращает объем выделенной памяти в байтах.
+    */
+    size_t GetAllocatedSize() const
+    {
+        return allocated_size_;
+    }
+
+private:
+    size_t block_size_;
+    std::vector<std::unique_ptr<char[]>> blocks_;
+    char* current_;
+    size_t remaining_size_;
+    size_t allocated_size_;
+};
+
+/*!
+* Таблица счетчиков строк. Ключи хранятся в арене, таблица использует
+* открытую адресацию с линейным пробированием. В ячейке хранится хеш ключа,
+* поэтому при расширении таблицы ключи не перечитываются, а при поиске
+* сравниваются только ключи с совпавшим хешем.
+*/
+class StringCounterTable
+{
+public:
+    struct Entry
+    {
+        StringView key;
+        size_t count;
+    };
+
+    using const_iterator = std::vector<Entry>::const_iterator;
+
+    StringCounterTable()
+        : slots_(16)
+        , peak_memory_usage_(0)
+        , probes_count_(0)
+        , rehashes_count_(0)
+    {
+        UpdatePeakMemoryUsage(0);
+    }
+
+    StringCounterTable(StringCounterTable&&) = default;
+    StringCounterTable& operator=(StringCounterTable&&) = default;
+
+    /*!
+    * Увеличивает счетчик ключа. При первой встрече ключ копируется в арену.
+    *
+    \param[in] key Ключ.
+    \param[in] count Величина, на которую увеличивается счетчик.
+    *
+    \return Номер записи ключа. Номера не меняются при расширении таблицы.
+    */
+    size_t Increment(
+            const StringView key,
+            const size_t count = 1)
+    {
+        const uint32_t hash = static_cast<uint32_t>(HashBytes(key.Data(), key.Size()));
+        const size_t mask = slots_.size() - 1;
+
+        for (size_t slot_index = hash & mask; ; slot_index = (slot_index + 1) & mask)
+        {
+            URL_STATISTICS_TELEMETRY_ADD(probes_count_, 1);
+            Slot& slot = slots_[slot_index];
+            if (slot.entry_number == 0)
+            {
+                entries_.push_back(Entry{arena_.Store(key), count});
+                slot.hash = hash;
+                slot.entry_number = static_cast<uint32_t>(entries_.size());
+                if (entries_.size() * 10 > slots_.size() * 7)
+                {
+                    Rehash(slots_.size() * 2);
+                }
+                else
+                {
+                    UpdatePeakMemoryUsage(0);
+                }
+
+                return entries_.size() - 1;
+            }
+
+            if (slot.hash == hash)
+            {
+                Entry& entry = entries_[slot.entry_number - 1];
+                if (entry.key.Size() == key.Size() &&
+                        std::memcmp(entry.key.Data(), key.Data(), key.Size()) == 0)
+                {
+                    entry.count += count;
+                    return slot.entry_number - 1;
+                }
+            }
+        }
+    }
+
+    /*!
+    * Возвращает номер записи ключа или size(), если ключа нет.
+    */
+    size_t Find(
+            const StringView key) const
+    {
+        const uint32_t hash = static_cast<uint32_t>(HashBytes(key.Data(), key.Size()));
+        const size_t mask = slots_.size() - 1;
+
+        for (size_t slot_index = hash & mask; ; slot_index = (slot_index + 1) & mask)
+        {
+            const Slot& slot = slots_[slot_index];
+            if (slot.entry_number == 0)
+            {
+                return entries_.size();
+            }
+
+            if (slot.hash == hash)
+            {
+                const Entry& entry = entries_[slot.entry_number - 1];
+                if (entry.key.Size() == key.Size() &&
+                        std::memcmp(entry.key.Data(), key.Data(), key.Size()) == 0)
+                {
+                    return slot.entry_number - 1;
+                }
+            }
+        }
+    }
+
+    const Entry& GetEntry(
+            const size_t entry_index) const
+    {
+        return entries_[entry_index];
+    }
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+    const_iterator begin() const
+    {
+        return entries_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return entries_.end();
+    }
+
+    void swap(
+            StringCounterTable& other)
+    {
+        std::swap(*this, other);
+    }
+
+    /*!
+    * Удаляет все ключи и освобождает занятую ими память разом.
+    */
+    void clear()
+    {
+        *this = StringCounterTable();
+    }
+
+    /*!
+    * Возвращает наибольший объем памяти в байтах, занимавшийся таблицей
+    * (ячейки, записи и арена с ключами).
+    */
+    size_t GetPeakMemoryUsage() const
+    {
+        return peak_memory_usage_;
+    }
+
+    /*!
+    * Возвращает количество просмотренных ячеек. Считается, только если
+    * включена телеметрия.
+    */
+    uint64_t GetProbesCount() const
+    {
+        return probes_count_;
+    }
+
+    /*!
+    * Возвращает количество перестроек таблицы. Считается, только если
+    * включена телеметрия.
+    */
+    uint64_t GetRehashesCount() const
+    {
+        return rehashes_count_;
+    }
+
+    /*!
+    * Возвращает объем памяти арены с ключами в байтах.
+    */
+    size_t GetArenaSize() const
+    {
+        return arena_.GetAllocatedSize();
+    }
+
+    /*!
+    * Добавляет счетчики телеметрии другой таблицы, например сливаемой в эту.
+    */
+    void AddTelemetryCounts(
+            const StringCounterTable& other)
+    {
+        probes_count_ += other.probes_count_;
+        rehashes_count_ += other.rehashes_count_;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        // Номер записи, увеличенный на единицу. 0 - ячейка свободна.
+        uint32_t entry_number = 0;
+    };
+
+    void Rehash(
+            const size_t slots_count)
+    {
+        URL_STATISTICS_TELEMETRY_ADD(rehashes_count_, 1);
+        std::vector<Slot> slots(slots_count);
+        // Во время перестройки живут и старые, и новые ячейки.
+        UpdatePeakMemoryUsage(slots.size() * sizeof(Slot));
+
+        const size_t mask = slots_count - 1;
+        for (const Slot& slot : slots_)
+        {
+            if (slot.entry_number == 0)
+            {
+                continue;
+            }
+
+            size_t slot_index = slot.hash & mask;
+            while (slots[slot_index].entry_number != 0)
+            {
+                slot_index = (slot_index + 1) & mask;
+            }
+
+            slots[slot_index] = slot;
+        }
+
+        slots_.swap(slots);
+    }
+
+    void UpdatePeakMemoryUsage(
+            const size_t temporary_memory_usage)
+    {
+        const size_t memory_usage =
+                slots_.capacity() * sizeof(Slot) +
+                entries_.capacity() * sizeof(Entry) +
+                arena_.GetAllocatedSize() +
+                temporary_memory_usage;
+        peak_memory_usage_ = std::max(peak_memory_usage_, memory_usage);
+    }
+
+private:
+    std::vector<Slot> slots_;
+    std::vector<Entry> entries_;
+    StringArena arena_;
+    size_t peak_memory_usage_;
+    uint64_t probes_count_;
+    uint64_t rehashes_count_;
+};
+
+/*!
+* Совместные счетчики пар (домен, путь). Ключ - номера записей домена и пути
+* в их таблицах StringCounterTable (8 байтов), поэтому строки повторно не
+* хранятся, а пары лежат в одной плоской таблице с открытой адресацией.
+*/
+class DomainPathCounterTable
+{
+public:
+    struct Entry
+    {
+        uint32_t domain_index;
+        uint32_t path_index;
+        size_t count;
+    };
+
+    using const_iterator = std::vector<Entry>::const_iterator;
+
+    DomainPathCounterTable()
+        : slots_(16)
+        , peak_memory_usage_(0)
+    {
+        UpdatePeakMemoryUsage(0);
+    }
+
+    DomainPathCounterTable(DomainPathCounterTable&&) = default;
+    DomainPathCounterTable& operator=(DomainPathCounterTable&&) = default;
+
+    /*!
+    * Увеличивает счетчик пары.
+    *
+    \param[in] domain_index Номер записи домена.
+    \param[in] path_index Номер записи пути.
+    \param[in] count Величина, на которую увеличивается счетчик.
+    */
+    void Increment(
+            const size_t domain_index,
+            const size_t path_index,
+            const size_t count = 1)
+    {
+        const uint64_t key = (static_cast<uint64_t>(domain_index) << 32) | path_index;
+        const uint32_t hash = static_cast<uint32_t>((key * 0x9e3779b97f4a7c15ULL) >> 32);
+        const size_t mask = slots_.size() - 1;
+
+        for (size_t slot_index = hash & mask; ; slot_index = (slot_index + 1) & mask)
+        {
+            Slot& slot = slots_[slot_index];
+            if (slot.entry_number == 0)
+            {
+                entries_.push_back(Entry{
+                        static_cast<uint32_t>(domain_index),
+                        static_cast<uint32_t>(path_index),
+                        count});
+                slot.hash = hash;
+                slot.entry_number = static_cast<uint32_t>(entries_.size());
+                if (entries_.size() * 10 > slots_.size() * 7)
+                {
+                    Rehash(slots_.size() * 2);
+                }
+                else
+                {
+                    UpdatePeakMemoryUsage(0);
+                }
+
+                return;
+            }
+
+            if (slot.hash == hash)
+            {
+                Entry& entry = entries_[slot.entry_number - 1];
+                if (entry.domain_index == domain_index && entry.path_index == path_index)
+                {
+                    entry.count += count;
+                    return;
+                }
+            }
+        }
+    }
+
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+    const_iterator begin() const
+    {
+        return entries_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return entries_.end();
+    }
+
+    void swap(
+            DomainPathCounterTable& other)
+    {
+        std::swap(*this, other);
+    }
+
+    /*!
+    * Возвращает наибольший объем памяти в байтах, занимавшийся таблицей.
+    */
+    size_t GetPeakMemoryUsage() const
+    {
+        return peak_memory_usage_;
+    }
+
+private:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        // Номер записи, увеличенный на единицу. 0 - ячейка свободна.
+        uint32_t entry_number = 0;
+    };
+
+    void Rehash(
+            const size_t slots_count)
+    {
+        std::vector<Slot> slots(slots_count);
+        UpdatePeakMemoryUsage(slots.size() * sizeof(Slot));
+
+        const size_t mask = slots_count - 1;
+        for (const Slot& slot : slots_)
+        {
+            if (slot.entry_number == 0)
+            {
+                continue;
+            }
+
+            size_t slot_index = slot.hash & mask;
+            while (slots[slot_index].entry_number != 0)
+            {
+                slot_index = (slot_index + 1) & mask;
+            }
+
+            slots[slot_index] = slot;
+        }
+
+        slots_.swap(slots);
+    }
+
+    void UpdatePeakMemoryUsage(
+            const size_t temporary_memory_usage)
+    {
+        const size_t memory_usage =
+                slots_.capacity() * sizeof(Slot) +
+                entries_.capacity() * sizeof(Entry) +
+                temporary_memory_usage;
+        peak_memory_usage_ = std::max(peak_memory_usage_, memory_usage);
+    }
+
+private:
+    std::vector<Slot> slots_;
+    std::vector<Entry> entries_;
+    size_t peak_memory_usage_;
+};
+
+/*!
+* Приближенный подсчет самых частых строк алгоритмом Space-Saving.
+* Отслеживается не более capacity ключей; новый ключ при заполненной таблице
+* вытесняет ключ с наименьшим счетчиком и наследует его значение.
+* Оценка счетчика любого отслеживаемого ключа не меньше истинной и превышает
+* ее не более чем на error этой записи, а error не превосходит
+* GetTotalCount() / capacity.
+*/
+class SpaceSavingCounter
+{
+public:
+    struct Entry
+    {
+        std::string key;
+        size_t count;
+        // Наибольшая возможная переоценка count.
+        size_t error;
+    };
+
+    using const_iterator = std::vector<Entry>::const_iterator;
+
+    /*!
+    * Конструктор.
+    *
+    \param[in] capacity Наибольшее количество отслеживаемых ключей.
+    */
+    explicit SpaceSavingCounter(
+            const size_t capacity = 0)
+        : capacity_(capacity)
+        , total_count_(0)
+    {
+        // Записи не перемещаются: на их ключи ссылается индекс.
+        entries_.reserve(capacity_);
+        heap_.reserve(capacity_);
+        heap_positions_.reserve(capacity_);
+        index_.reserve(capacity_);
+    }
+
+    SpaceSavingCounter(const SpaceSavingCounter&) = delete;
+    SpaceSavingCounter& operator=(const SpaceSavingCounter&) = delete;
+    SpaceSavingCounter(SpaceSavingCounter&&) = default;
+    SpaceSavingCounter& operator=(SpaceSavingCounter&&) = default;
+
+    void Increment(
+            const StringView key,
+            const size_t count = 1)
+    {
+        Add(key, count, 0);
+    }
+
+    /*!
+    * Добавляет к счетчикам данные другого счетчика той же емкости. Ключ,
+    * отсутствующий в заполненном счетчике, мог иметь в нем значение не больше
+    * минимального, поэтому минимум прибавляется к оценке и к ошибке.
+    */
+    void Merge(
+            SpaceSavingCounter& other)
+    {
+        const size_t this_minimum = GetMinimumCount();
+        const size_t other_minimum = other.GetMinimumCount();
+
+        std::vector<Entry> merged_entries;
+        merged_entries.reserve(entries_.size() + other.entries_.size());
+        for (Entry& entry : entries_)
+        {
+            const auto other_entry = other.index_.find(StringView(entry.key));
+            if (other_entry != other.index_.end())
+            {
+                const Entry& found_entry = other.entries_[other_entry->second];
+                entry.count += found_entry.count;
+                entry.error += found_entry.error;
+            }
+            else
+            {
+                entry.count += other_minimum;
+                entry.error += other_minimum;
+            }
+        }
+
+        // Ключи переносятся только после всех поисков: на них ссылаются индексы.
+        for (Entry& entry : other.entries_)
+        {
+            if (index_.find(StringView(entry.key)) == index_.end())
+            {
+                entry.count += this_minimum;
+                entry.error += this_minimum;
+                merged_entries.push_back(std::move(entry));
+            }
+        }
+
+        for (Entry& entry : entries_)
+        {
+            merged_entries.push_back(std::move(entry));
+        }
+
+        // Оставляем capacity наибольших оценок; при равенстве - по ключу,
+        // чтобы результат не зависел от порядка записей.
+        const auto greater = [](const Entry& left, const Entry& right)
+        {
+            return left.count != right.count
+                    ? left.count > right.count
+                    : left.key < right.key;
+        };
+        if (merged_entries.size() > capacity_)
+        {
+            std::nth_element(
+                    merged_entries.begin(),
+                    merged_entries.begin() + capacity_,
+                    merged_entries.end(),
+                    greater);
+            merged_entries.resize(capacity_);
+        }
+
+        const size_t total_count = total_count_ + other.total_count_;
+        *this = SpaceSavingCounter(capacity_);
+        for (Entry& entry : merged_entries)
+        {
+            Add(entry.key, entry.count, entry.error);
+        }
+
+        total_count_ = total_count;
+        other = SpaceSavingCounter(other.capacity_);
+    }
+
+    /*!
+    * Возвращает количество отслеживаемых ключей. Пока счетчик не заполнен,
+    * это точное количество различных ключей.
+    */
+    size_t size() const
+    {
+        return entries_.size();
+    }
+
+    bool empty() const
+    {
+        return entries_.empty();
+    }
+
+    const_iterator begin() const
+    {
+        return entries_.begin();
+    }
+
+    const_iterator end() const
+    {
+        return entries_.end();
+    }
+
+    /*!
+    * Возвращает сумму всех добавленных значений.
+    */
+    size_t GetTotalCount() const
+    {
+        return total_count_;
+    }
+
+    /*!
+    * Возвращает наибольшую ошибку среди отслеживаемых ключей.
+    */
+    size_t GetMaximumError() const
+    {
+        size_t maximum_error = 0;
+        for (const Entry& entry : entries_)
+        {
+            maximum_error = std::max(maximum_error, entry.error);
+        }
+
+        return maximum_error;
+    }
+
+    /*!
+    * Возвращает примерный объем занимаемой памяти в байтах.
+    */
+    size_t GetMemoryUsage() const
+    {
+        size_t memory_usage =
+                entries_.capacity() * sizeof(Entry) +
+                heap_.capacity() * sizeof(uint32_t) +
+                heap_positions_.capacity() * sizeof(uint32_t) +
+                index_.bucket_count() * sizeof(void*) +
+                index_.size() * (sizeof(StringView) + sizeof(uint32_t) + 2 * sizeof(void*));
+        for (const Entry& entry : entries_)
+        {
+            memory_usage += entry.key.capacity();
+        }
+
+        return memory_usage;
+    }
+
+private:
+    size_t GetMinimumCount() const
+    {
+        return entries_.size() < capacity_ || heap_.empty()
+                ? 0
+                : entries_[heap_.front()].count;
+    }
+
+    void Add(
+            const StringView key,
+            const size_t count,
+            const size_t error)
+    {
+        total_count_ += count;
+        if (capacity_ == 0)
+        {
+            return;
+        }
+
+        const auto found_entry = index_.find(key);
+        if (found_entry != index_.end())
+        {
+            Entry& entry = entries_[found_entry->second];
+            entry.count += count;
+            entry.error += error;
+            SiftDown(heap_positions_[found_entry->second]);
+            return;
+        }
+
+        if (entries_.size() < capacity_)
+        {
+            const uint32_t entry_index = static_cast<uint32_t>(entries_.size());
+            entries_.push_back(Entry{key.ToString(), count, error});
+            index_.emplace(StringView(entries_.back().key), entry_index);
+            heap_.push_back(entry_index);
+            heap_positions_.push_back(static_cast<uint32_t>(heap_.size() - 1));
+            SiftUp(heap_.size() - 1);
+            return;
+        }
+
+        // Вытесняем ключ с наименьшим счетчиком.
+        const uint32_t entry_index = heap_.front();
+        Entry& entry = entries_[entry_index];
+        index_.erase(StringView(entry.key));
+        entry.key.assign(key.Data(), key.Size());
+        entry.error = entry.count + error;
+        entry.count += count;
+        index_.emplace(StringView(entry.key), entry_index);
+        SiftDown(0);
+    }
+
+    bool IsLess(
+            const size_t left_heap_position,
+            const size_t right_heap_position) const
+    {
+        return entries_[heap_[left_heap_position]].count <
+                entries_[heap_[right_heap_position]].count;
+    }
+
+    void SwapHeapItems(
+            const size_t left_heap_position,
+            const size_t right_heap_position)
+    {
+        std::swap(heap_[left_heap_position], heap_[right_heap_position]);
+        heap_positions_[heap_[left_heap_position]] = static_cast<uint32_t>(left_heap_position);
+        heap_positions_[heap_[right_heap_position]] = static_cast<uint32_t>(right_heap_position);
+    }
+
+    void SiftUp(
+            size_t heap_position)
+    {
+        while (heap_position != 0)
+        {
+            const size_t parent_position = (heap_position - 1) / 2;
+            if (!IsLess(heap_position, parent_position))
+            {
+                break;
+            }
+
+            SwapHeapItems(heap_position, parent_position);
+            heap_position = parent_position;
+        }
+    }
+
+    void SiftDown(
+            size_t heap_position)
+    {
+        for (;;)
+        {
+            size_t smallest_position = heap_position;
+            const size_t left_child_position = 2 * heap_position + 1;
+            const size_t right_child_position = left_child_position + 1;
+            if (left_child_position < heap_.size() &&
+                    IsLess(left_child_position, smallest_position))
+            {
+                smallest_position = left_child_position;
+            }
+
+            if (right_child_position < heap_.size() &&
+                    IsLess(right_child_position, smallest_position))
+            {
+                smallest_position = right_child_position;
+            }
+
+            if (smallest_position == heap_position)
+            {
+                break;
+            }
+
+            SwapHeapItems(heap_position, smallest_position);
+            heap_position = smallest_position;
+        }
+    }
+
+private:
+    size_t capacity_;
+    size_t total_count_;
+    std::vector<Entry> entries_;
+    // Двоичная куча номеров записей с минимальным счетчиком в вершине.
+    std::vector<uint32_t> heap_;
+    // Позиция каждой записи в куче.
+    std::vector<uint32_t> heap_positions_;
+    std::unordered_map<StringView, uint32_t, StringViewHash> index_;
+};
+
+/*!
+* Возвращает количество старших нулевых битов. value не должно быть нулевым.
+*/
+inline unsigned CountLeadingZeros64(
+        const uint64_t value)
+{
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return 63 - static_cast<unsigned>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32)))
+    {
+        return 31 - static_cast<unsigned>(index);
+    }
+
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return 63 - static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_clzll(value));
+#endif
+}
+
+/*!
+* Оценка количества различных строк алгоритмом HyperLogLog. Занимает
+* 2^precision байт независимо от количества строк; стандартная
+* относительная ошибка около 1.04 / sqrt(2^precision). Оценки, собранные по
+* разным частям данных, можно объединять.
+*/
+class HyperLogLog
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] precision Количество битов хеша, выбирающих регистр (4..18).
+    * 0 - оценка не ведется.
+    */
+    explicit HyperLogLog(
+            const size_t precision = 0)
+        : precision_(precision)
+        , registers_(precision == 0 ? 0 : size_t(1) << precision)
+    {
+        if (precision != 0 && (precision < 4 || precision > 18))
+        {
+            throw std::invalid_argument(
+                    "HyperLogLog : Precision must be in range [4, 18]!");
+        }
+    }
+
+    void Add(
+            const StringView data)
+    {
+        AddHash(HashBytes(data.Data(), data.Size()));
+    }
+
+    void AddHash(
+            const uint64_t hash)
+    {
+        const size_t register_index = static_cast<size_t>(hash >> (64 - precision_));
+        // Ставим единицу после значащих битов, чтобы ранг не превысил 64 - precision + 1.
+        const uint64_t rest = (hash << precision_) | (uint64_t(1) << (precision_ - 1));
+        const uint8_t rank = static_cast<uint8_t>(CountLeadingZeros64(rest) + 1);
+        registers_[register_index] = std::max(registers_[register_index], rank);
+    }
+
+    /*!
+    * Объединяет оценку с оценкой той же точности.
+    */
+    void Merge(
+            const HyperLogLog& other)
+    {
+        for (size_t i = 0; i < registers_.size(); ++i)
+        {
+            registers_[i] = std::max(registers_[i], other.registers_[i]);
+        }
+    }
+
+    /*!
+    * Возвращает оценку количества различных строк.
+    */
+    size_t Estimate() const
+    {
+        if (registers_.empty())
+        {
+            return 0;
+        }
+
+        const double registers_count = static_cast<double>(registers_.size());
+        double inverse_sum = 0.0;
+        size_t zero_registers_count = 0;
+        for (const uint8_t rank : registers_)
+        {
+            inverse_sum += std::ldexp(1.0, -static_cast<int>(rank));
+            zero_registers_count += rank == 0;
+        }
+
+        // Для 16, 32 и 64 регистров приближенная формула смещена, поэтому
+        // берутся табличные значения.
+        const double alpha =
+                registers_.size() == 16 ? 0.673 :
+                registers_.size() == 32 ? 0.697 :
+                registers_.size() == 64 ? 0.709 :
+                0.7213 / (1.0 + 1.079 / registers_count);
+        const double estimate = alpha * registers_count * registers_count / inverse_sum;
+
+        // Для малых значений точнее линейный подсчет по пустым регистрам.
+        if (estimate <= 2.5 * registers_count && zero_registers_count != 0)
+        {
+            return static_cast<size_t>(std::llround(
+                    registers_count * std::log(registers_count / zero_registers_count)));
+        }
+
+        return static_cast<size_t>(std::llround(estimate));
+    }
+
+    bool IsEnabled() const
+    {
+        return precision_ != 0;
+    }
+
+    size_t GetMemoryUsage() const
+    {
+        return registers_.capacity();
+    }
+
+private:
+    size_t precision_;
+    std::vector<uint8_t> registers_;
+};
+
+using StringToCountMap = StringCounterTable;
+
+/*!
+* Ссылка на ключ и его счетчик.
+*/
+struct KeyCountHandle
+{
+    StringView key;
+    size_t count;
+};
+
+/*!
+* Порядок записей в отчете: по убыванию счетчика, при равенстве - по ключу
+* без учета регистра.
+*/
+inline bool IsRankedHigher(
+        const KeyCountHandle& left,
+        const KeyCountHandle& right)
+{
+    if (left.count != right.count)
+    {
+        return left.count > right.count;
+    }
+
+    return CompareCaseInsensitive(left.key, right.key) < 0;
+}
+
+/*!
+* Тот же порядок для ключей, уже приведенных к нижнему регистру: регистр
+* при сравнении не учитывается, ключи сравниваются побайтово.
+*/
+inline bool IsRankedHigherByBytes(
+        const KeyCountHandle& left,
+        const KeyCountHandle& right)
+{
+    if (left.count != right.count)
+    {
+        return left.count > right.count;
+    }
+
+    return CompareBytes(left.key, right.key) < 0;
+}
+
+/*!
+* Переставляет в начало handles size_of_top записей с наибольшим рангом в
+* порядке отчета. Остальные записи остаются в произвольном порядке.
+*
+\param[in] are_keys_case_folded Все ключи уже приведены к нижнему регистру.
+*
+\return Конец отобранных записей.
+*/
+inline std::vector<KeyCountHandle>::iterator SelectTopN(
+        std::vector<KeyCountHandle>& handles,
+        const size_t size_of_top,
+        const bool are_keys_case_folded = false)
+{
+    const auto is_ranked_higher = are_keys_case_folded ? IsRankedHigherByBytes : IsRankedHigher;
+    const std::vector<KeyCountHandle>::iterator top_end =
+            handles.begin() + std::min(size_of_top, handles.size());
+    if (top_end != handles.end())
+    {
+        std::nth_element(handles.begin(), top_end, handles.end(), is_ranked_higher);
+    }
+
+    std::sort(handles.begin(), top_end, is_ranked_higher);
+    return top_end;
+}
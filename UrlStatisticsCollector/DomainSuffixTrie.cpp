@@ -0,0 +1,214 @@
+﻿#include "DomainSuffixTrie.h"
+
+#include <cstring>
+
+namespace
+{
+
+// Публичные зоны второго уровня, в которых чаще всего регистрируются домены.
+const char* const known_public_suffixes[] =
+{
+    "ac.jp", "ac.uk", "co.il", "co.in", "co.jp", "co.kr", "co.nz", "co.uk",
+    "co.za", "com.ar", "com.au", "com.br", "com.cn", "com.hk", "com.mx",
+    "com.my", "com.sg", "com.tr", "com.tw", "com.ua", "gov.uk", "ne.jp",
+    "net.au", "net.cn", "or.jp", "org.au", "org.cn", "org.uk", "spb.ru",
+    "msk.ru"
+};
+
+bool AreEqualCaseInsensitive(
+        const StringView left,
+        const StringView right)
+{
+    if (left.Size() != right.Size())
+    {
+        return false;
+    }
+
+    for (size_t i = 0; i < left.Size(); ++i)
+    {
+        if (ToLowerCaseSymbol(left[i]) != ToLowerCaseSymbol(right[i]))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Хеш метки без учета регистра вместе с номером родителя (FNV-1a).
+uint32_t HashLabel(
+        const size_t parent_index,
+        const StringView label)
+{
+    uint64_t hash = 0xcbf29ce484222325ULL ^ (parent_index * 0x9e3779b97f4a7c15ULL);
+    for (size_t i = 0; i < label.Size(); ++i)
+    {
+        hash = (hash ^ ToLowerCaseSymbol(label[i])) * 0x100000001b3ULL;
+    }
+
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+} // namespace
+
+bool IsKnownPublicSuffix(
+        const StringView suffix)
+{
+    for (const char* const public_suffix : known_public_suffixes)
+    {
+        if (AreEqualCaseInsensitive(suffix, StringView(public_suffix, std::strlen(public_suffix))))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+DomainSuffixTrie::DomainSuffixTrie()
+    : nodes_(1, Node{StringView(), 0, 0, 0, true, false})
+    , slots_(16)
+{
+}
+
+void DomainSuffixTrie::Add(
+        StringView domain,
+        const size_t count)
+{
+    // Завершающая точка корневой зоны ("example.com.") не образует метку.
+    if (!domain.Empty() && domain[domain.Size() - 1] == '.')
+    {
+        domain = domain.Substring(0, domain.Size() - 1);
+    }
+
+    if (domain.Empty() || (domain[domain.Size() - 1] >= '0' && domain[domain.Size() - 1] <= '9'))
+    {
+        return;
+    }
+
+    nodes_.front().count += count;
+    size_t node_index = 0;
+    size_t label_end = domain.Size();
+    for (;;)
+    {
+        size_t label_begin = label_end;
+        while (label_begin != 0 && domain[label_begin - 1] != '.')
+        {
+            --label_begin;
+        }
+
+        node_index = FindOrAddChild(
+                node_index,
+                domain.Substring(label_begin, domain.Size() - label_begin),
+                label_end - label_begin);
+        nodes_[node_index].count += count;
+        if (label_begin == 0)
+        {
+            break;
+        }
+
+        label_end = label_begin - 1;
+    }
+}
+
+std::vector<KeyCountHandle> DomainSuffixTrie::GetLevel(
+        const size_t level) const
+{
+    std::vector<KeyCountHandle> handles;
+    for (size_t i = 1; i < nodes_.size(); ++i)
+    {
+        const Node& node = nodes_[i];
+        if (level == registrable_domain_level ? node.is_registrable : node.depth == level)
+        {
+            handles.push_back(KeyCountHandle{node.suffix, node.count});
+        }
+    }
+
+    return handles;
+}
+
+size_t DomainSuffixTrie::GetMemoryUsage() const
+{
+    return nodes_.capacity() * sizeof(Node) + slots_.capacity() * sizeof(Slot);
+}
+
+size_t DomainSuffixTrie::FindOrAddChild(
+        const size_t parent_index,
+        const StringView suffix,
+        const size_t label_size)
+{
+    const StringView label = suffix.Substring(0, label_size);
+    const uint32_t hash = HashLabel(parent_index, label);
+    const size_t mask = slots_.size() - 1;
+
+    for (size_t slot_index = hash & mask; ; slot_index = (slot_index + 1) & mask)
+    {
+        Slot& slot = slots_[slot_index];
+        if (slot.node_number == 0)
+        {
+            const Node& parent = nodes_[parent_index];
+            const uint32_t depth = parent.depth + 1;
+            const bool is_public_suffix =
+                    depth == 1 || (depth == 2 && IsKnownPublicSuffix(suffix));
+            const bool is_registrable = !is_public_suffix && parent.is_public_suffix;
+            nodes_.push_back(Node{
+                    suffix,
+                    0,
+                    static_cast<uint32_t>(parent_index),
+                    depth,
+                    is_public_suffix,
+                    is_registrable});
+            slot.hash = hash;
+            slot.node_number = static_cast<uint32_t>(nodes_.size());
+            if (nodes_.size() * 10 > slots_.size() * 7)
+            {
+                Rehash(slots_.size() * 2);
+            }
+
+            return nodes_.size() - 1;
+        }
+
+        if (slot.hash == hash)
+        {
+            Node& node = nodes_[slot.node_number - 1];
+            // У совпавших родителей суффиксы одной длины, поэтому равная
+            // длина суффиксов означает равную длину меток.
+            if (node.parent_index == parent_index &&
+                    node.suffix.Size() == suffix.Size() &&
+                    AreEqualCaseInsensitive(node.suffix.Substring(0, label_size), label))
+            {
+                // Суффикс узла не должен зависеть от порядка добавления доменов.
+                if (CompareBytes(suffix, node.suffix) > 0)
+                {
+                    node.suffix = suffix;
+                }
+
+                return slot.node_number - 1;
+            }
+        }
+    }
+}
+
+void DomainSuffixTrie::Rehash(
+        const size_t slots_count)
+{
+    std::vector<Slot> slots(slots_count);
+    const size_t mask = slots_count - 1;
+    for (const Slot& slot : slots_)
+    {
+        if (slot.node_number == 0)
+        {
+            continue;
+        }
+
+        size_t slot_index = slot.hash & mask;
+        while (slots[slot_index].node_number != 0)
+        {
+            slot_index = (slot_index + 1) & mask;
+        }
+
+        slots[slot_index] = slot;
+    }
+
+    slots_.swap(slots);
+}
@@ -0,0 +1,108 @@
+﻿#pragma once
+
+#include <vector>
+#include <limits>
+#include <cstdint>
+
+#include "StringView.h"
+#include "Counters.h"
+
+// Уровень свертки, соответствующий регистрируемому домену (eTLD+1):
+// "en.wikipedia.org" -> "wikipedia.org", "news.bbc.co.uk" -> "bbc.co.uk".
+const size_t registrable_domain_level = std::numeric_limits<size_t>::max();
+
+/*!
+* Возвращает true, если суффикс из двух меток - известная публичная зона
+* второго уровня ("co.uk", "com.au", ...), в которой регистрируются домены
+* третьего уровня. Регистр не учитывается. Используется компактная выборка
+* наиболее распространенных зон Public Suffix List, а не весь список.
+*/
+bool IsKnownPublicSuffix(
+        const StringView suffix);
+
+/*!
+* Дерево суффиксов доменов: метки домена добавляются справа налево, поэтому
+* "en.wikipedia.org" и "de.wikipedia.org" разделяют узлы "org" и
+* "wikipedia.org". Счетчик узла - суммарный счетчик всех доменов, оканчивающихся
+* его суффиксом, так что за один проход по доменам заполняются все уровни.
+* Метки сравниваются без учета регистра.
+*
+* Узлы не хранят копий строк: суффикс узла ссылается на добавленный домен,
+* поэтому домены должны жить дольше дерева.
+*/
+class DomainSuffixTrie
+{
+public:
+    struct Node
+    {
+        // Суффикс домена, заканчивающийся последней меткой. Из вариантов,
+        // различающихся регистром, хранится наибольший побайтово (строчные
+        // буквы больше прописных).
+        StringView suffix;
+        size_t count;
+        uint32_t parent_index;
+        // Количество меток в суффиксе.
+        uint32_t depth;
+        bool is_public_suffix;
+        bool is_registrable;
+    };
+
+    DomainSuffixTrie();
+
+    /*!
+    * Добавляет счетчик домена ко всем его суффиксам. Домены, оканчивающиеся
+    * числовой меткой (IPv4-адреса), не иерархичны и пропускаются.
+    *
+    \param[in] domain Домен. Должен жить дольше дерева.
+    \param[in] count Счетчик домена.
+    */
+    void Add(
+            const StringView domain,
+            const size_t count);
+
+    /*!
+    * Возвращает ссылки на узлы уровня level за один проход по узлам.
+    *
+    \param[in] level Количество меток в суффиксе или registrable_domain_level.
+    */
+    std::vector<KeyCountHandle> GetLevel(
+            const size_t level) const;
+
+    /*!
+    * Возвращает узлы дерева. Узел 0 - корень с пустым суффиксом.
+    */
+    const std::vector<Node>& GetNodes() const
+    {
+        return nodes_;
+    }
+
+    /*!
+    * Возвращает объем памяти в байтах, занимаемый узлами и индексом.
+    */
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        // Номер узла, увеличенный на единицу. 0 - ячейка свободна.
+        uint32_t node_number = 0;
+    };
+
+    /*!
+    * Возвращает номер дочернего узла parent_index с меткой из первых
+    * label_size символов suffix, создавая его при первой встрече.
+    */
+    size_t FindOrAddChild(
+            const size_t parent_index,
+            const StringView suffix,
+            const size_t label_size);
+
+    void Rehash(
+            const size_t slots_count);
+
+private:
+    std::vector<Node> nodes_;
+    // Индекс детей по паре (родитель, метка), общий для всех узлов.
+    std::vector<Slot> slots_;
+};
@@ -0,0 +1,1234 @@
+﻿#include "InputSource.h"
+
+#include <algorithm>
+#include <fstream>
+
+#if defined(URL_STATISTICS_HAVE_ZLIB)
+#include <zlib.h>
+#endif
+
+#if defined(URL_STATISTICS_HAVE_ZSTD)
+#include <zstd.h>
+#endif
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#include <io.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <glob.h>
+#endif
+
+#if defined(URL_STATISTICS_HAVE_IO_URING)
+#include <cerrno>
+#include <linux/io_uring.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#endif
+
+MappedFileInputSource::MappedFileInputSource(
+        const std::string& input_file_path)
+    : data_(nullptr)
+    , size_(0)
+    , is_block_read_(false)
+#if defined(_WIN32)
+    , file_(INVALID_HANDLE_VALUE)
+    , mapping_(nullptr)
+#endif
+{
+#if defined(_WIN32)
+    file_ = CreateFileA(
+            input_file_path.c_str(),
+            GENERIC_READ,
+            FILE_SHARE_READ,
+            nullptr,
+            OPEN_EXISTING,
+            FILE_FLAG_SEQUENTIAL_SCAN,
+            nullptr);
+    LARGE_INTEGER file_size;
+    if (file_ == INVALID_HANDLE_VALUE ||
+            !GetFileSizeEx(file_, &file_size))
+    {
+        Close();
+        throw std::invalid_argument(
+                "MappedFileInputSource : Can not open input file!");
+    }
+
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping_ != nullptr)
+    {
+        data_ = static_cast<const char*>(
+                MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0));
+    }
+#else
+    const int file_descriptor = open(input_file_path.c_str(), O_RDONLY);
+    struct stat file_status;
+    if (file_descriptor < 0 ||
+            fstat(file_descriptor, &file_status) != 0)
+    {
+        if (file_descriptor >= 0)
+        {
+            close(file_descriptor);
+        }
+
+        throw std::invalid_argument(
+                "MappedFileInputSource : Can not open input file!");
+    }
+
+    size_ = static_cast<size_t>(file_status.st_size);
+    void* mapping = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, file_descriptor, 0);
+    // Дескриптор после отображения не нужен: отображение держит файл само.
+    close(file_descriptor);
+    if (mapping != MAP_FAILED)
+    {
+        data_ = static_cast<const char*>(mapping);
+        madvise(mapping, size_, MADV_SEQUENTIAL);
+    }
+#endif
+    if (data_ == nullptr)
+    {
+        Close();
+        throw std::invalid_argument(
+                "MappedFileInputSource : Can not map input file!");
+    }
+}
+
+MappedFileInputSource::~MappedFileInputSource()
+{
+    Close();
+}
+
+void MappedFileInputSource::Close()
+{
+#if defined(_WIN32)
+    if (data_ != nullptr)
+    {
+        UnmapViewOfFile(data_);
+    }
+
+    if (mapping_ != nullptr)
+    {
+        CloseHandle(mapping_);
+    }
+
+    if (file_ != INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(file_);
+    }
+#else
+    if (data_ != nullptr)
+    {
+        munmap(const_cast<char*>(data_), size_);
+    }
+#endif
+    data_ = nullptr;
+}
+
+#if defined(URL_STATISTICS_HAVE_ZLIB)
+/*!
+* Распаковывает поток в формате gzip (в том числе из нескольких
+* последовательных частей, как после конкатенации архивов).
+*/
+class GzipByteStream : public ByteStream
+{
+public:
+    explicit GzipByteStream(
+            std::unique_ptr<ByteStream> source)
+        : source_(std::move(source))
+        , input_buffer_(1 << 18)
+        , is_inside_member_(false)
+        , is_end_of_stream_(false)
+    {
+        std::memset(&stream_, 0, sizeof(stream_));
+        // 15 + 32: максимальное окно и автоопределение заголовка gzip/zlib.
+        if (inflateInit2(&stream_, 15 + 32) != Z_OK)
+        {
+            throw std::runtime_error(
+                    "GzipByteStream : Can not initialize decompressor!");
+        }
+    }
+
+    ~GzipByteStream() override
+    {
+        inflateEnd(&stream_);
+    }
+
+    GzipByteStream(const GzipByteStream&) = delete;
+    GzipByteStream& operator=(const GzipByteStream&) = delete;
+
+    size_t Read(
+            char* buffer,
+            const size_t size) override
+    {
+        stream_.next_out = reinterpret_cast<Bytef*>(buffer);
+        stream_.avail_out = static_cast<uInt>(std::min<size_t>(size, UINT32_MAX));
+
+        while (stream_.avail_out != 0 && !is_end_of_stream_)
+        {
+            if (stream_.avail_in == 0)
+            {
+                const size_t read_size = source_->Read(input_buffer_.data(), input_buffer_.size());
+                if (read_size == 0)
+                {
+                    if (is_inside_member_)
+                    {
+                        throw std::runtime_error(
+                                "GzipByteStream : Input file is truncated!");
+                    }
+
+                    is_end_of_stream_ = true;
+                    break;
+                }
+
+                stream_.next_in = reinterpret_cast<Bytef*>(input_buffer_.data());
+                stream_.avail_in = static_cast<uInt>(read_size);
+            }
+
+            const int result = inflate(&stream_, Z_NO_FLUSH);
+            is_inside_member_ = result != Z_STREAM_END;
+            if (result == Z_STREAM_END)
+            {
+                // За концом части может начинаться следующая.
+                inflateReset(&stream_);
+            }
+            else if (result != Z_OK && result != Z_BUF_ERROR)
+            {
+                throw std::runtime_error(
+                        "GzipByteStream : Input file is corrupted!");
+            }
+        }
+
+        return size - stream_.avail_out;
+    }
+
+private:
+    std::unique_ptr<ByteStream> source_;
+    std::vector<char> input_buffer_;
+    z_stream stream_;
+    bool is_inside_member_;
+    bool is_end_of_stream_;
+};
+#endif
+
+#if defined(URL_STATISTICS_HAVE_ZSTD)
+/*!
+* Распаковывает поток в формате zstd (в том числе из нескольких кадров).
+*/
+class ZstdByteStream : public ByteStream
+{
+public:
+    explicit ZstdByteStream(
+            std::unique_ptr<ByteStream> source)
+        : source_(std::move(source))
+        , stream_(ZSTD_createDStream())
+        , input_buffer_(ZSTD_DStreamInSize())
+        , input_{nullptr, 0, 0}
+        , is_end_of_stream_(false)
+    {
+        if (stream_ == nullptr ||
+                ZSTD_isError(ZSTD_initDStream(stream_)))
+        {
+            ZSTD_freeDStream(stream_);
+            throw std::runtime_error(
+                    "ZstdByteStream : Can not initialize decompressor!");
+        }
+    }
+
+    ~ZstdByteStream() override
+    {
+        ZSTD_freeDStream(stream_);
+    }
+
+    ZstdByteStream(const ZstdByteStream&) = delete;
+    ZstdByteStream& operator=(const ZstdByteStream&) = delete;
+
+    size_t Read(
+            char* buffer,
+            const size_t size) override
+    {
+        ZSTD_outBuffer output = {buffer, size, 0};
+
+        while (output.pos != output.size && !is_end_of_stream_)
+        {
+            if (input_.pos == input_.size)
+            {
+                const size_t read_size = source_->Read(input_buffer_.data(), input_buffer_.size());
+                if (read_size == 0)
+                {
+                    is_end_of_stream_ = true;
+                    break;
+                }
+
+                input_ = ZSTD_inBuffer{input_buffer_.data(), read_size, 0};
+            }
+
+            if (ZSTD_isError(ZSTD_decompressStream(stream_, &output, &input_)))
+            {
+                throw std::runtime_error(
+                        "ZstdByteStream : Input file is corrupted!");
+            }
+        }
+
+        return output.pos;
+    }
+
+private:
+    std::unique_ptr<ByteStream> source_;
+    ZSTD_DStream* stream_;
+    std::vector<char> input_buffer_;
+    ZSTD_inBuffer input_;
+    bool is_end_of_stream_;
+};
+#endif
+
+/*!
+* Оборачивает поток распаковщиком, если данные сжаты.
+*/
+inline std::unique_ptr<ByteStream> CreateDecompressingStream(
+        std::unique_ptr<ByteStream> stream,
+        const CompressionFormat compression_format)
+{
+    switch (compression_format)
+    {
+    case CompressionFormat::Gzip:
+#if defined(URL_STATISTICS_HAVE_ZLIB)
+        return std::unique_ptr<ByteStream>(new GzipByteStream(std::move(stream)));
+#else
+        throw std::invalid_argument(
+                "UrlStatisticsCollector : gzip input is not supported by this build!");
+#endif
+    case CompressionFormat::Zstd:
+#if defined(URL_STATISTICS_HAVE_ZSTD)
+        return std::unique_ptr<ByteStream>(new ZstdByteStream(std::move(stream)));
+#else
+        throw std::invalid_argument(
+                "UrlStatisticsCollector : zstd input is not supported by this build!");
+#endif
+    default:
+        return stream;
+    }
+}
+
+/*!
+* Выполняет чтения файла по заданным смещениям, не блокируя вызывающий поток.
+* Для каждого буфера одновременно выполняется не больше одного чтения.
+*/
+class AsynchronousReader
+{
+public:
+    virtual ~AsynchronousReader()
+    {
+    }
+
+    /*!
+    * Отправляет чтение size байтов со смещения offset в data.
+    */
+    virtual void SubmitRead(
+            const size_t buffer_index,
+            char* data,
+            const size_t size,
+            const uint64_t offset) = 0;
+
+    /*!
+    * Ждет завершения любого из отправленных чтений.
+    *
+    \param[out] buffer_index Буфер завершенного чтения.
+    \param[out] result Количество прочитанных байтов, 0 - конец файла,
+    * отрицательное значение - ошибка.
+    */
+    virtual void WaitForCompletion(
+            size_t& buffer_index,
+            int64_t& result) = 0;
+
+    virtual bool IsUsingIoUring() const
+    {
+        return false;
+    }
+};
+
+/*!
+* Выполняет чтения по очереди в фоновом потоке. Работает на любой платформе.
+*/
+class ThreadedAsynchronousReader : public AsynchronousReader
+{
+public:
+    explicit ThreadedAsynchronousReader(
+            const std::string& input_file_path)
+        : input_file_(std::fopen(input_file_path.c_str(), "rb"))
+        , position_(0)
+        , is_stopped_(false)
+    {
+        if (input_file_ == nullptr)
+        {
+            throw std::invalid_argument(
+                    "AsynchronousFileInputSource : Can not open input file!");
+        }
+
+        worker_ = std::thread(&ThreadedAsynchronousReader::Work, this);
+    }
+
+    ~ThreadedAsynchronousReader() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_stopped_ = true;
+        }
+
+        condition_.notify_all();
+        worker_.join();
+        std::fclose(input_file_);
+    }
+
+    ThreadedAsynchronousReader(const ThreadedAsynchronousReader&) = delete;
+    ThreadedAsynchronousReader& operator=(const ThreadedAsynchronousReader&) = delete;
+
+    void SubmitRead(
+            const size_t buffer_index,
+            char* data,
+            const size_t size,
+            const uint64_t offset) override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            requests_.push_back(Request{buffer_index, data, size, offset});
+        }
+
+        condition_.notify_all();
+    }
+
+    void WaitForCompletion(
+            size_t& buffer_index,
+            int64_t& result) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        condition_.wait(lock, [this] { return !completions_.empty(); });
+        buffer_index = completions_.front().first;
+        result = completions_.front().second;
+        completions_.pop_front();
+    }
+
+private:
+    struct Request
+    {
+        size_t buffer_index;
+        char* data;
+        size_t size;
+        uint64_t offset;
+    };
+
+    void Work()
+    {
+        for (;;)
+        {
+            Request request;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return is_stopped_ || !requests_.empty(); });
+                if (is_stopped_)
+                {
+                    return;
+                }
+
+                request = requests_.front();
+                requests_.pop_front();
+            }
+
+            const int64_t result = Read(request);
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                completions_.emplace_back(request.buffer_index, result);
+            }
+
+            condition_.notify_all();
+        }
+    }
+
+    int64_t Read(
+            const Request& request)
+    {
+        // Чтения обычно идут подряд, поэтому позиционирование почти не нужно.
+        if (request.offset != position_)
+        {
+#if defined(_WIN32)
+            const int seek_result = _fseeki64(input_file_, static_cast<__int64>(request.offset), SEEK_SET);
+#else
+            const int seek_result = fseeko(input_file_, static_cast<off_t>(request.offset), SEEK_SET);
+#endif
+            if (seek_result != 0)
+            {
+                return -1;
+            }
+        }
+
+        const size_t read_size = std::fread(request.data, 1, request.size, input_file_);
+        position_ = request.offset + read_size;
+        if (read_size == 0 && std::ferror(input_file_))
+        {
+            return -1;
+        }
+
+        return static_cast<int64_t>(read_size);
+    }
+
+private:
+    FILE* input_file_;
+    uint64_t position_;
+    bool is_stopped_;
+    std::deque<Request> requests_;
+    std::deque<std::pair<size_t, int64_t>> completions_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread worker_;
+};
+
+#if defined(URL_STATISTICS_HAVE_IO_URING) && defined(__NR_io_uring_setup)
+/*!
+* Выполняет чтения через io_uring. Кольца создаются системными вызовами
+* напрямую, без liburing.
+*/
+class IoUringAsynchronousReader : public AsynchronousReader
+{
+public:
+    /*!
+    * Конструктор. Если io_uring недоступен (старое ядро, запрет в seccomp)
+    * или файл не открывается, IsInitialized вернет false.
+    *
+    \param[in] input_file_path Путь к файлу.
+    \param[in] buffers_count Наибольшее количество одновременных чтений.
+    */
+    IoUringAsynchronousReader(
+            const std::string& input_file_path,
+            const size_t buffers_count)
+        : file_descriptor_(open(input_file_path.c_str(), O_RDONLY))
+        , ring_descriptor_(-1)
+        , submission_ring_(MAP_FAILED)
+        , submission_ring_size_(0)
+        , completion_ring_(MAP_FAILED)
+        , completion_ring_size_(0)
+        , submission_entries_(static_cast<io_uring_sqe*>(MAP_FAILED))
+        , submission_entries_size_(0)
+        , vectors_(buffers_count)
+    {
+        if (file_descriptor_ < 0)
+        {
+            return;
+        }
+
+        io_uring_params parameters;
+        std::memset(&parameters, 0, sizeof(parameters));
+        const int ring_descriptor = static_cast<int>(syscall(
+                __NR_io_uring_setup,
+                static_cast<unsigned>(buffers_count),
+                &parameters));
+        if (ring_descriptor < 0)
+        {
+            return;
+        }
+
+        ring_descriptor_ = ring_descriptor;
+        submission_ring_size_ = parameters.sq_off.array + parameters.sq_entries * sizeof(unsigned);
+        completion_ring_size_ = parameters.cq_off.cqes + parameters.cq_entries * sizeof(io_uring_cqe);
+        submission_entries_size_ = parameters.sq_entries * sizeof(io_uring_sqe);
+        submission_ring_ = mmap(
+                nullptr, submission_ring_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_descriptor_, IORING_OFF_SQ_RING);
+        completion_ring_ = mmap(
+                nullptr, completion_ring_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_descriptor_, IORING_OFF_CQ_RING);
+        submission_entries_ = static_cast<io_uring_sqe*>(mmap(
+                nullptr, submission_entries_size_, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring_descriptor_, IORING_OFF_SQES));
+        if (!IsInitialized())
+        {
+            return;
+        }
+
+        char* const submission_ring = static_cast<char*>(submission_ring_);
+        submission_tail_ = reinterpret_cast<unsigned*>(submission_ring + parameters.sq_off.tail);
+        submission_mask_ = *reinterpret_cast<unsigned*>(submission_ring + parameters.sq_off.ring_mask);
+        submission_array_ = reinterpret_cast<unsigned*>(submission_ring + parameters.sq_off.array);
+
+        char* const completion_ring = static_cast<char*>(completion_ring_);
+        completion_head_ = reinterpret_cast<unsigned*>(completion_ring + parameters.cq_off.head);
+        completion_tail_ = reinterpret_cast<unsigned*>(completion_ring + parameters.cq_off.tail);
+        completion_mask_ = *reinterpret_cast<unsigned*>(completion_ring + parameters.cq_off.ring_mask);
+        completions_ = reinterpret_cast<io_uring_cqe*>(completion_ring + parameters.cq_off.cqes);
+    }
+
+    ~IoUringAsynchronousReader() override
+    {
+        if (submission_entries_ != MAP_FAILED)
+        {
+            munmap(submission_entries_, submission_entries_size_);
+        }
+
+        if (completion_ring_ != MAP_FAILED)
+        {
+            munmap(completion_ring_, completion_ring_size_);
+        }
+
+        if (submission_ring_ != MAP_FAILED)
+        {
+            munmap(submission_ring_, submission_ring_size_);
+        }
+
+        if (ring_descriptor_ >= 0)
+        {
+            close(ring_descriptor_);
+        }
+
+        if (file_descriptor_ >= 0)
+        {
+            close(file_descriptor_);
+        }
+    }
+
+    IoUringAsynchronousReader(const IoUringAsynchronousReader&) = delete;
+    IoUringAsynchronousReader& operator=(const IoUringAsynchronousReader&) = delete;
+
+    bool IsInitialized() const
+    {
+        return file_descriptor_ >= 0 &&
+                ring_descriptor_ >= 0 &&
+                submission_ring_ != MAP_FAILED &&
+                completion_ring_ != MAP_FAILED &&
+                submission_entries_ != MAP_FAILED;
+    }
+
+    bool IsUsingIoUring() const override
+    {
+        return true;
+    }
+
+    void SubmitRead(
+            const size_t buffer_index,
+            char* data,
+            const size_t size,
+            const uint64_t offset) override
+    {
+        // Вектор живет до завершения чтения: для буфера выполняется одно чтение за раз.
+        vectors_[buffer_index].iov_base = data;
+        vectors_[buffer_index].iov_len = size;
+
+        // Очередь отправки заполняет только этот поток.
+        const unsigned tail = *submission_tail_;
+        const unsigned index = tail & submission_mask_;
+        io_uring_sqe& entry = submission_entries_[index];
+        std::memset(&entry, 0, sizeof(entry));
+        entry.opcode = IORING_OP_READV;
+        entry.fd = file_descriptor_;
+        entry.addr = reinterpret_cast<uint64_t>(&vectors_[buffer_index]);
+        entry.len = 1;
+        entry.off = offset;
+        entry.user_data = buffer_index;
+        submission_array_[index] = index;
+        __atomic_store_n(submission_tail_, tail + 1, __ATOMIC_RELEASE);
+
+        int result;
+        do
+        {
+            result = static_cast<int>(syscall(__NR_io_uring_enter, ring_descriptor_, 1, 0, 0, nullptr, 0));
+        }
+        while (result < 0 && errno == EINTR);
+
+        if (result < 0)
+        {
+            throw std::runtime_error(
+                    "AsynchronousFileInputSource : Can not submit read!");
+        }
+    }
+
+    void WaitForCompletion(
+            size_t& buffer_index,
+            int64_t& result) override
+    {
+        for (;;)
+        {
+            const unsigned head = *completion_head_;
+            if (head != __atomic_load_n(completion_tail_, __ATOMIC_ACQUIRE))
+            {
+                const io_uring_cqe& completion = completions_[head & completion_mask_];
+                buffer_index = static_cast<size_t>(completion.user_data);
+                result = completion.res;
+                __atomic_store_n(completion_head_, head + 1, __ATOMIC_RELEASE);
+                return;
+            }
+
+            if (syscall(__NR_io_uring_enter, ring_descriptor_, 0, 1, IORING_ENTER_GETEVENTS, nullptr, 0) < 0 &&
+                    errno != EINTR)
+            {
+                throw std::runtime_error(
+                        "AsynchronousFileInputSource : Can not wait for read!");
+            }
+        }
+    }
+
+private:
+    int file_descriptor_;
+    int ring_descriptor_;
+    void* submission_ring_;
+    size_t submission_ring_size_;
+    void* completion_ring_;
+    size_t completion_ring_size_;
+    io_uring_sqe* submission_entries_;
+    size_t submission_entries_size_;
+    unsigned* submission_tail_;
+    unsigned submission_mask_;
+    unsigned* submission_array_;
+    unsigned* completion_head_;
+    unsigned* completion_tail_;
+    unsigned completion_mask_;
+    io_uring_cqe* completions_;
+    std::vector<iovec> vectors_;
+};
+#endif
+
+AsynchronousFileInputSource::AsynchronousFileInputSource(
+        const std::string& input_file_path,
+        const size_t buffers_count,
+        const size_t buffer_size,
+        const bool is_io_uring_allowed)
+    : file_size_(0)
+    , buffer_size_(std::max<size_t>(buffer_size, 1))
+    , next_offset_(0)
+    , in_flight_reads_count_(0)
+    , current_buffer_index_(NoBuffer)
+{
+    FileStatus file_status;
+    if (!GetFileStatus(input_file_path, file_status))
+    {
+        throw std::invalid_argument(
+                "AsynchronousFileInputSource : Can not open input file!");
+    }
+
+    file_size_ = file_status.size;
+
+    // Начало каждого буфера выровнено по странице.
+    const size_t alignment = 4096;
+    const size_t buffer_stride = (buffer_size_ + alignment - 1) / alignment * alignment;
+    buffers_.resize(std::max<size_t>(buffers_count, 2));
+    storage_.resize(buffers_.size() * buffer_stride + alignment);
+    char* const aligned_storage = storage_.data() +
+            (alignment - reinterpret_cast<uintptr_t>(storage_.data()) % alignment) % alignment;
+    for (size_t i = 0; i < buffers_.size(); ++i)
+    {
+        buffers_[i] = Buffer{aligned_storage + i * buffer_stride, 0, 0, 0, true};
+    }
+
+#if defined(URL_STATISTICS_HAVE_IO_URING) && defined(__NR_io_uring_setup)
+    if (is_io_uring_allowed)
+    {
+        std::unique_ptr<IoUringAsynchronousReader> io_uring_reader(
+                new IoUringAsynchronousReader(input_file_path, buffers_.size()));
+        if (io_uring_reader->IsInitialized())
+        {
+            reader_ = std::move(io_uring_reader);
+        }
+    }
+#else
+    static_cast<void>(is_io_uring_allowed);
+#endif
+
+    if (!reader_)
+    {
+        reader_.reset(new ThreadedAsynchronousReader(input_file_path));
+    }
+
+    for (size_t i = 0; i < buffers_.size(); ++i)
+    {
+        SubmitNextRead(i);
+    }
+}
+
+AsynchronousFileInputSource::~AsynchronousFileInputSource()
+{
+    // Буферы нельзя освобождать, пока в них идет чтение.
+    try
+    {
+        for (; in_flight_reads_count_ != 0; --in_flight_reads_count_)
+        {
+            size_t buffer_index;
+            int64_t result;
+            reader_->WaitForCompletion(buffer_index, result);
+        }
+    }
+    catch (...)
+    {
+    }
+}
+
+bool AsynchronousFileInputSource::ReadBlock(
+        StringView& block)
+{
+    if (!pending_block_.Empty())
+    {
+        block = pending_block_;
+        pending_block_ = StringView();
+        return true;
+    }
+
+    if (current_buffer_index_ != NoBuffer)
+    {
+        SubmitNextRead(current_buffer_index_);
+        current_buffer_index_ = NoBuffer;
+    }
+
+    while (!pending_buffer_indexes_.empty())
+    {
+        const size_t buffer_index = pending_buffer_indexes_.front();
+        WaitForBuffer(buffer_index);
+        pending_buffer_indexes_.pop_front();
+
+        const Buffer& buffer = buffers_[buffer_index];
+        const char* const end = buffer.data + buffer.filled_size;
+        const char* const first_line_end = static_cast<const char*>(
+                std::memchr(buffer.data, '\n', buffer.filled_size));
+        if (first_line_end == nullptr)
+        {
+            // Строка длиннее буфера.
+            carry_.append(buffer.data, buffer.filled_size);
+            SubmitNextRead(buffer_index);
+            continue;
+        }
+
+        const char* last_line_end = end - 1;
+        while (*last_line_end != '\n')
+        {
+            --last_line_end;
+        }
+
+        current_buffer_index_ = buffer_index;
+        if (carry_.empty())
+        {
+            block = StringView(buffer.data, last_line_end + 1 - buffer.data);
+        }
+        else
+        {
+            joined_line_.assign(carry_);
+            joined_line_.append(buffer.data, first_line_end + 1 - buffer.data);
+            block = StringView(joined_line_.data(), joined_line_.size());
+            pending_block_ = StringView(first_line_end + 1, last_line_end - first_line_end);
+        }
+
+        carry_.assign(last_line_end + 1, end);
+        return true;
+    }
+
+    if (!carry_.empty())
+    {
+        // Последняя строка без перевода строки.
+        joined_line_.swap(carry_);
+        carry_.clear();
+        block = StringView(joined_line_.data(), joined_line_.size());
+        return true;
+    }
+
+    return false;
+}
+
+bool AsynchronousFileInputSource::IsUsingIoUring() const
+{
+    return reader_->IsUsingIoUring();
+}
+
+void AsynchronousFileInputSource::SubmitNextRead(
+        const size_t buffer_index)
+{
+    if (next_offset_ >= file_size_)
+    {
+        return;
+    }
+
+    Buffer& buffer = buffers_[buffer_index];
+    buffer.offset = next_offset_;
+    buffer.requested_size = static_cast<size_t>(
+            std::min<uint64_t>(buffer_size_, file_size_ - next_offset_));
+    buffer.filled_size = 0;
+    buffer.is_complete = false;
+    next_offset_ += buffer.requested_size;
+    pending_buffer_indexes_.push_back(buffer_index);
+    reader_->SubmitRead(buffer_index, buffer.data, buffer.requested_size, buffer.offset);
+    ++in_flight_reads_count_;
+}
+
+void AsynchronousFileInputSource::WaitForBuffer(
+        const size_t buffer_index)
+{
+    while (!buffers_[buffer_index].is_complete)
+    {
+        size_t completed_buffer_index;
+        int64_t result;
+        reader_->WaitForCompletion(completed_buffer_index, result);
+        --in_flight_reads_count_;
+
+        Buffer& buffer = buffers_[completed_buffer_index];
+        if (result < 0)
+        {
+            buffer.is_complete = true;
+            throw std::runtime_error(
+                    "AsynchronousFileInputSource : Can not read input file!");
+        }
+
+        buffer.filled_size += static_cast<size_t>(result);
+        if (result != 0 && buffer.filled_size < buffer.requested_size)
+        {
+            // Короткое чтение: дочитываем остаток в тот же буфер.
+            reader_->SubmitRead(
+                    completed_buffer_index,
+                    buffer.data + buffer.filled_size,
+                    buffer.requested_size - buffer.filled_size,
+                    buffer.offset + buffer.filled_size);
+            ++in_flight_reads_count_;
+        }
+        else
+        {
+            // Нулевой результат означает, что файл укоротили во время чтения.
+            buffer.is_complete = true;
+        }
+    }
+}
+
+std::unique_ptr<InputSource> OpenInputSource(
+        const std::string& input_file_path,
+        const FileReadMode file_read_mode)
+{
+    const bool is_standard_input = input_file_path == "-";
+    FILE* input_file = is_standard_input
+            ? stdin
+            : std::fopen(input_file_path.c_str(), "rb");
+    if (input_file == nullptr)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteStatistics : Can not open input file!");
+    }
+
+    std::unique_ptr<FileByteStream> file_stream(
+            new FileByteStream(input_file, !is_standard_input));
+    const CompressionFormat compression_format =
+            DetectCompressionFormat(file_stream->Peek(4));
+
+    if (compression_format != CompressionFormat::None)
+    {
+        return std::unique_ptr<InputSource>(
+                new PipelinedInputSource(
+                    CreateDecompressingStream(
+                        std::move(file_stream),
+                        compression_format)));
+    }
+
+#if defined(_WIN32)
+    WIN32_FILE_ATTRIBUTE_DATA file_attributes;
+    const bool is_mappable =
+            !is_standard_input &&
+            GetFileAttributesExA(
+                input_file_path.c_str(),
+                GetFileExInfoStandard,
+                &file_attributes) &&
+            !(file_attributes.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) &&
+            (file_attributes.nFileSizeHigh != 0 || file_attributes.nFileSizeLow != 0);
+#else
+    struct stat file_status;
+    const bool is_mappable =
+            !is_standard_input &&
+            fstat(fileno(input_file), &file_status) == 0 &&
+            S_ISREG(file_status.st_mode) &&
+            file_status.st_size > 0;
+#endif
+
+    if (is_mappable && file_read_mode == FileReadMode::Asynchronous)
+    {
+        return std::unique_ptr<InputSource>(
+                new AsynchronousFileInputSource(input_file_path));
+    }
+
+    if (is_mappable)
+    {
+        try
+        {
+            return std::unique_ptr<InputSource>(
+                    new MappedFileInputSource(input_file_path));
+        }
+        catch (std::invalid_argument&)
+        {
+            // Отобразить не удалось, пробуем читать обычным образом.
+        }
+    }
+
+    return std::unique_ptr<InputSource>(
+            new BufferedInputSource(std::move(file_stream)));
+}
+
+std::vector<std::string> ExpandPathPattern(
+        const std::string& path_pattern)
+{
+    if (path_pattern.find_first_of("*?[") == std::string::npos)
+    {
+        return std::vector<std::string>(1, path_pattern);
+    }
+
+    std::vector<std::string> paths;
+#if defined(_WIN32)
+    const std::string::size_type directory_end = path_pattern.find_last_of("\\/");
+    const std::string directory = directory_end == std::string::npos
+            ? std::string()
+            : path_pattern.substr(0, directory_end + 1);
+    WIN32_FIND_DATAA find_data;
+    const HANDLE find_handle = FindFirstFileA(path_pattern.c_str(), &find_data);
+    if (find_handle != INVALID_HANDLE_VALUE)
+    {
+        do
+        {
+            if (!(find_data.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY))
+            {
+                paths.push_back(directory + find_data.cFileName);
+            }
+        }
+        while (FindNextFileA(find_handle, &find_data));
+        FindClose(find_handle);
+    }
+
+    std::sort(paths.begin(), paths.end());
+#else
+    glob_t glob_result;
+    if (glob(path_pattern.c_str(), 0, nullptr, &glob_result) == 0)
+    {
+        paths.assign(glob_result.gl_pathv, glob_result.gl_pathv + glob_result.gl_pathc);
+    }
+
+    globfree(&glob_result);
+#endif
+
+    if (paths.empty())
+    {
+        paths.push_back(path_pattern);
+    }
+
+    return paths;
+}
+
+std::vector<std::string> ExpandInputFilePaths(
+        const std::vector<std::string>& arguments)
+{
+    std::vector<std::string> input_file_paths;
+    for (const std::string& argument : arguments)
+    {
+        std::vector<std::string> path_patterns;
+        if (argument.size() > 1 && argument[0] == '@')
+        {
+            std::ifstream file_list(argument.substr(1));
+            if (!file_list.is_open())
+            {
+                throw std::invalid_argument(
+                        "UrlStatisticsCollector : Can not open file list " + argument.substr(1) + "!");
+            }
+
+            std::string line;
+            while (std::getline(file_list, line))
+            {
+                if (!line.empty() && line.back() == '\r')
+                {
+                    line.pop_back();
+                }
+
+                if (!line.empty())
+                {
+                    path_patterns.push_back(line);
+                }
+            }
+        }
+        else
+        {
+            path_patterns.push_back(argument);
+        }
+
+        for (const std::string& path_pattern : path_patterns)
+        {
+            const std::vector<std::string> paths = ExpandPathPattern(path_pattern);
+            input_file_paths.insert(input_file_paths.end(), paths.begin(), paths.end());
+        }
+    }
+
+    return input_file_paths;
+}
+
+bool GetFileStatus(
+        FILE* file,
+        FileStatus& file_status)
+{
+#if defined(_WIN32)
+    BY_HANDLE_FILE_INFORMATION file_information;
+    if (!GetFileInformationByHandle(
+            reinterpret_cast<HANDLE>(_get_osfhandle(_fileno(file))),
+            &file_information))
+    {
+        return false;
+    }
+
+    file_status.device = file_information.dwVolumeSerialNumber;
+    file_status.index =
+            (static_cast<uint64_t>(file_information.nFileIndexHigh) << 32) |
+            file_information.nFileIndexLow;
+    file_status.size =
+            (static_cast<uint64_t>(file_information.nFileSizeHigh) << 32) |
+            file_information.nFileSizeLow;
+#else
+    struct stat status;
+    if (fstat(fileno(file), &status) != 0)
+    {
+        return false;
+    }
+
+    file_status.device = static_cast<uint64_t>(status.st_dev);
+    file_status.index = static_cast<uint64_t>(status.st_ino);
+    file_status.size = static_cast<uint64_t>(status.st_size);
+#endif
+    return true;
+}
+
+bool GetFileStatus(
+        const std::string& file_path,
+        FileStatus& file_status)
+{
+#if defined(_WIN32)
+    const HANDLE file = CreateFileA(
+            file_path.c_str(),
+            0,
+            FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+            nullptr,
+            OPEN_EXISTING,
+            0,
+            nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    BY_HANDLE_FILE_INFORMATION file_information;
+    const bool is_received = GetFileInformationByHandle(file, &file_information) != 0;
+    CloseHandle(file);
+    if (!is_received)
+    {
+        return false;
+    }
+
+    file_status.device = file_information.dwVolumeSerialNumber;
+    file_status.index =
+            (static_cast<uint64_t>(file_information.nFileIndexHigh) << 32) |
+            file_information.nFileIndexLow;
+    file_status.size =
+            (static_cast<uint64_t>(file_information.nFileSizeHigh) << 32) |
+            file_information.nFileSizeLow;
+#else
+    struct stat status;
+    if (stat(file_path.c_str(), &status) != 0)
+    {
+        return false;
+    }
+
+    file_status.device = static_cast<uint64_t>(status.st_dev);
+    file_status.index = static_cast<uint64_t>(status.st_ino);
+    file_status.size = static_cast<uint64_t>(status.st_size);
+#endif
+    return true;
+}
+
+bool IsReplaceableFile(
+        const std::string& file_path)
+{
+#if defined(_WIN32)
+    const DWORD attributes = GetFileAttributesA(file_path.c_str());
+    if (attributes == INVALID_FILE_ATTRIBUTES)
+    {
+        return GetLastError() == ERROR_FILE_NOT_FOUND;
+    }
+
+    return (attributes & (FILE_ATTRIBUTE_DIRECTORY | FILE_ATTRIBUTE_DEVICE)) == 0;
+#else
+    struct stat status;
+    if (lstat(file_path.c_str(), &status) != 0)
+    {
+        return errno == ENOENT;
+    }
+
+    return S_ISREG(status.st_mode);
+#endif
+}
+
+std::string CreateTemporaryFile(
+        const std::string& file_path)
+{
+#if defined(_WIN32)
+    for (unsigned attempt = 0; attempt < 100; ++attempt)
+    {
+        const std::string temporary_file_path =
+                file_path + '.' + std::to_string(GetCurrentProcessId()) +
+                '.' + std::to_string(GetTickCount() + attempt);
+        const HANDLE file = CreateFileA(
+                temporary_file_path.c_str(),
+                GENERIC_WRITE,
+                0,
+                nullptr,
+                CREATE_NEW,
+                FILE_ATTRIBUTE_NORMAL,
+                nullptr);
+        if (file != INVALID_HANDLE_VALUE)
+        {
+            CloseHandle(file);
+            return temporary_file_path;
+        }
+
+        if (GetLastError() != ERROR_FILE_EXISTS)
+        {
+            break;
+        }
+    }
+
+    return std::string();
+#else
+    std::string temporary_file_path = file_path + ".XXXXXX";
+    const int file = mkstemp(&temporary_file_path[0]);
+    if (file == -1)
+    {
+        return std::string();
+    }
+
+    // mkstemp создает файл с правами 0600, а переименование их сохраняет.
+    // Берем права заменяемого файла или обычные для нового файла.
+    struct stat status;
+    mode_t mode = 0;
+    if (stat(file_path.c_str(), &status) == 0)
+    {
+        mode = status.st_mode & 07777;
+    }
+    else
+    {
+        const mode_t creation_mask = umask(0);
+        umask(creation_mask);
+        mode = 0666 & ~creation_mask;
+    }
+
+    fchmod(file, mode);
+    close(file);
+    return temporary_file_path;
+#endif
+}
+
+bool ReplaceFileAtomically(
+        const std::string& source_file_path,
+        const std::string& target_file_path)
+{
+#if defined(_WIN32)
+    return MoveFileExA(
+            source_file_path.c_str(),
+            target_file_path.c_str(),
+            MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(source_file_path.c_str(), target_file_path.c_str()) == 0;
+#endif
+}
@@ -0,0 +1,897 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+#include <functional>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+#include "StringView.h"
+
+/*!
+* Источник входных данных. Отдает данные блоками, каждый из которых
+* заканчивается на границе строки (кроме, возможно, последнего блока).
+*/
+class InputSource
+{
+public:
+    virtual ~InputSource()
+    {
+    }
+
+    /*!
+    * Читает очередной блок входных данных.
+    *
+    \param[out] block Прочитанный блок. Действителен до следующего вызова ReadBlock.
+    *
+    \return true если блок прочитан, false если данные закончились.
+    */
+    virtual bool ReadBlock(
+            StringView& block) = 0;
+
+    /*!
+    * Возвращает true, если источник отдает весь файл одним блоком,
+    * отображенным в память и действительным все время жизни источника.
+    */
+    virtual bool IsMemoryMapped() const
+    {
+        return false;
+    }
+};
+
+/*!
+* Источник данных, отображающий файл в память целиком. Данные не копируются:
+* весь файл отдается одним блоком.
+*/
+class MappedFileInputSource : public InputSource
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] input_file_path Путь к обычному непустому файлу.
+    */
+    explicit MappedFileInputSource(
+            const std::string& input_file_path);
+
+    ~MappedFileInputSource() override;
+
+    MappedFileInputSource(const MappedFileInputSource&) = delete;
+    MappedFileInputSource& operator=(const MappedFileInputSource&) = delete;
+
+    bool IsMemoryMapped() const override
+    {
+        return true;
+    }
+
+    bool ReadBlock(
+            StringView& block) override
+    {
+        if (is_block_read_)
+        {
+            return false;
+        }
+
+        block = StringView(data_, size_);
+        is_block_read_ = true;
+        return true;
+    }
+
+private:
+    void Close();
+
+private:
+    const char* data_;
+    size_t size_;
+    bool is_block_read_;
+#if defined(_WIN32)
+    // Описатели файла и отображения (HANDLE), windows.h в заголовок не включается.
+    void* file_;
+    void* mapping_;
+#endif
+};
+
+/*!
+* Поток байтов без разбиения на строки (файл, распаковщик и т.п.).
+*/
+class ByteStream
+{
+public:
+    virtual ~ByteStream()
+    {
+    }
+
+    /*!
+    * Читает очередную порцию данных.
+    *
+    \param[out] buffer Буфер для данных.
+    \param[in] size Размер буфера.
+    *
+    \return Количество прочитанных байтов, 0 - данные закончились.
+    */
+    virtual size_t Read(
+            char* buffer,
+            const size_t size) = 0;
+};
+
+/*!
+* Поток байтов из открытого файла. Позволяет заглянуть в начало потока,
+* не теряя прочитанных данных (например, чтобы определить формат сжатия).
+*/
+class FileByteStream : public ByteStream
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] input_file Открытый на чтение файл.
+    \param[in] is_owner Нужно ли закрыть файл в деструкторе.
+    */
+    FileByteStream(
+            FILE* input_file,
+            const bool is_owner)
+        : input_file_(input_file)
+        , is_owner_(is_owner)
+        , peeked_position_(0)
+    {
+    }
+
+    ~FileByteStream() override
+    {
+        if (is_owner_)
+        {
+            std::fclose(input_file_);
+        }
+    }
+
+    FileByteStream(const FileByteStream&) = delete;
+    FileByteStream& operator=(const FileByteStream&) = delete;
+
+    /*!
+    * Возвращает первые байты потока. Они будут прочитаны повторно через Read.
+    *
+    \param[in] size Желаемое количество байтов; меньше, если поток короче.
+    */
+    StringView Peek(
+            const size_t size)
+    {
+        while (peeked_data_.size() < size)
+        {
+            const size_t old_size = peeked_data_.size();
+            peeked_data_.resize(size);
+            const size_t read_size = std::fread(
+                    &peeked_data_[old_size],
+                    1,
+                    size - old_size,
+                    input_file_);
+            peeked_data_.resize(old_size + read_size);
+            if (read_size == 0)
+            {
+                break;
+            }
+        }
+
+        return StringView(peeked_data_.data(), std::min(size, peeked_data_.size()));
+    }
+
+    size_t Read(
+            char* buffer,
+            const size_t size) override
+    {
+        if (peeked_position_ < peeked_data_.size())
+        {
+            const size_t copied_size = std::min(size, peeked_data_.size() - peeked_position_);
+            std::memcpy(buffer, peeked_data_.data() + peeked_position_, copied_size);
+            peeked_position_ += copied_size;
+            return copied_size;
+        }
+
+        return std::fread(buffer, 1, size, input_file_);
+    }
+
+private:
+    FILE* input_file_;
+    bool is_owner_;
+    std::vector<char> peeked_data_;
+    size_t peeked_position_;
+};
+
+/*!
+* Читает поток байтов в буферы так, что каждый заполненный буфер
+* заканчивается на границе строки. Незаконченная строка переносится в
+* начало следующего буфера.
+*/
+class LineAlignedReader
+{
+public:
+    explicit LineAlignedReader(
+            std::unique_ptr<ByteStream> stream)
+        : stream_(std::move(stream))
+        , is_end_of_stream_(false)
+    {
+    }
+
+    /*!
+    * Заполняет буфер очередным блоком строк. Если строка не помещается в
+    * буфер, буфер увеличивается.
+    *
+    \param[in,out] buffer Буфер. Его размер не уменьшается.
+    *
+    \return Размер блока в начале буфера, 0 - данные закончились.
+    */
+    size_t Fill(
+            std::vector<char>& buffer)
+    {
+        if (buffer.size() < carry_.size() + 1)
+        {
+            buffer.resize(std::max<size_t>(carry_.size() * 2, 1));
+        }
+
+        std::memcpy(buffer.data(), carry_.data(), carry_.size());
+        size_t filled_size = carry_.size();
+        size_t search_position = filled_size;
+        carry_.clear();
+
+        while (!is_end_of_stream_)
+        {
+            if (filled_size == buffer.size())
+            {
+                buffer.resize(buffer.size() * 2);
+            }
+
+            const size_t read_size = stream_->Read(
+                    buffer.data() + filled_size,
+                    buffer.size() - filled_size);
+            if (read_size == 0)
+            {
+                is_end_of_stream_ = true;
+                break;
+            }
+
+            filled_size += read_size;
+            const char* last_line_end = FindLastLineEnd(
+                    buffer.data() + search_position,
+                    buffer.data() + filled_size);
+            if (last_line_end != nullptr)
+            {
+                const size_t block_size =
+                        static_cast<size_t>(last_line_end - buffer.data()) + 1;
+                carry_.assign(buffer.data() + block_size, buffer.data() + filled_size);
+                return block_size;
+            }
+
+            search_position = filled_size;
+        }
+
+        return filled_size;
+    }
+
+private:
+    static const char* FindLastLineEnd(
+            const char* begin,
+            const char* end)
+    {
+        for (const char* current = end; current != begin; --current)
+        {
+            if (*(current - 1) == '\n')
+            {
+                return current - 1;
+            }
+        }
+
+        return nullptr;
+    }
+
+private:
+    std::unique_ptr<ByteStream> stream_;
+    std::vector<char> carry_;
+    bool is_end_of_stream_;
+};
+
+/*!
+* Источник данных с буферизованным чтением. Используется для потоков,
+* которые нельзя отобразить в память (pipe, stdin, символьные устройства).
+*/
+class BufferedInputSource : public InputSource
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] stream Поток входных данных.
+    \param[in] buffer_size Начальный размер буфера. Если строка в него не
+    * помещается, буфер увеличивается.
+    */
+    explicit BufferedInputSource(
+            std::unique_ptr<ByteStream> stream,
+            const size_t buffer_size = 1 << 20)
+        : reader_(std::move(stream))
+        , buffer_(std::max<size_t>(buffer_size, 1))
+    {
+    }
+
+    bool ReadBlock(
+            StringView& block) override
+    {
+        const size_t block_size = reader_.Fill(buffer_);
+        block = StringView(buffer_.data(), block_size);
+        return block_size != 0;
+    }
+
+private:
+    LineAlignedReader reader_;
+    std::vector<char> buffer_;
+};
+
+/*!
+* Источник данных, читающий (и при необходимости распаковывающий) поток в
+* фоновом потоке. Пока разбирается один буфер, следующие уже заполняются.
+* Буферы переиспользуются: буфер, отданный в ReadBlock, возвращается в пул
+* при следующем вызове.
+*/
+class PipelinedInputSource : public InputSource
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] stream Поток входных данных.
+    \param[in] buffers_count Количество буферов (не меньше двух).
+    \param[in] buffer_size Начальный размер каждого буфера.
+    */
+    explicit PipelinedInputSource(
+            std::unique_ptr<ByteStream> stream,
+            const size_t buffers_count = 4,
+            const size_t buffer_size = 1 << 22)
+        : reader_(std::move(stream))
+        , buffers_(std::max<size_t>(buffers_count, 2), std::vector<char>(std::max<size_t>(buffer_size, 1)))
+        , current_buffer_index_(NoBuffer)
+        , is_stopped_(false)
+    {
+        for (size_t i = 0; i < buffers_.size(); ++i)
+        {
+            free_buffer_indexes_.push_back(i);
+        }
+
+        producer_ = std::thread(&PipelinedInputSource::Produce, this);
+    }
+
+    ~PipelinedInputSource() override
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            is_stopped_ = true;
+        }
+
+        condition_.notify_all();
+        producer_.join();
+    }
+
+    PipelinedInputSource(const PipelinedInputSource&) = delete;
+    PipelinedInputSource& operator=(const PipelinedInputSource&) = delete;
+
+    bool ReadBlock(
+            StringView& block) override
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        if (current_buffer_index_ != NoBuffer)
+        {
+            free_buffer_indexes_.push_back(current_buffer_index_);
+            current_buffer_index_ = NoBuffer;
+            condition_.notify_all();
+        }
+
+        condition_.wait(lock, [this] { return !ready_blocks_.empty(); });
+        const ReadyBlock ready_block = ready_blocks_.front();
+        ready_blocks_.pop_front();
+
+        if (ready_block.size == 0)
+        {
+            // Признак конца данных оставляем для повторных вызовов.
+            ready_blocks_.push_front(ready_block);
+            if (producer_exception_)
+            {
+                std::rethrow_exception(producer_exception_);
+            }
+
+            return false;
+        }
+
+        current_buffer_index_ = ready_block.buffer_index;
+        block = StringView(buffers_[ready_block.buffer_index].data(), ready_block.size);
+        return true;
+    }
+
+private:
+    struct ReadyBlock
+    {
+        size_t buffer_index;
+        size_t size;
+    };
+
+    static const size_t NoBuffer = static_cast<size_t>(-1);
+
+    void Produce()
+    {
+        for (;;)
+        {
+            size_t buffer_index;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                condition_.wait(lock, [this] { return is_stopped_ || !free_buffer_indexes_.empty(); });
+                if (is_stopped_)
+                {
+                    return;
+                }
+
+                buffer_index = free_buffer_indexes_.front();
+                free_buffer_indexes_.pop_front();
+            }
+
+            size_t block_size = 0;
+            try
+            {
+                block_size = reader_.Fill(buffers_[buffer_index]);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                producer_exception_ = std::current_exception();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex_);
+                ready_blocks_.push_back(ReadyBlock{buffer_index, block_size});
+            }
+
+            condition_.notify_all();
+            if (block_size == 0)
+            {
+                return;
+            }
+        }
+    }
+
+private:
+    LineAlignedReader reader_;
+    std::vector<std::vector<char>> buffers_;
+    std::deque<size_t> free_buffer_indexes_;
+    std::deque<ReadyBlock> ready_blocks_;
+    size_t current_buffer_index_;
+    bool is_stopped_;
+    std::exception_ptr producer_exception_;
+    std::mutex mutex_;
+    std::condition_variable condition_;
+    std::thread producer_;
+};
+
+class AsynchronousReader;
+
+/*!
+* Источник данных, читающий обычный файл асинхронно несколькими большими
+* выровненными буферами: пока разбирается один буфер, чтение следующих уже
+* выполняется. В Linux чтения отправляются через io_uring, если ядро его
+* поддерживает; иначе (и на других платформах) их выполняет фоновый поток.
+*
+* Буферы читаются по фиксированным смещениям, поэтому строка может оказаться
+* разрезана границей буферов. Такая строка склеивается в отдельном небольшом
+* блоке, а остальные строки буфера отдаются без копирования.
+*/
+class AsynchronousFileInputSource : public InputSource
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] input_file_path Путь к обычному несжатому файлу.
+    \param[in] buffers_count Количество буферов (не меньше двух).
+    \param[in] buffer_size Размер каждого буфера.
+    \param[in] is_io_uring_allowed Можно ли использовать io_uring. false -
+    * всегда читать фоновым потоком.
+    */
+    explicit AsynchronousFileInputSource(
+            const std::string& input_file_path,
+            const size_t buffers_count = 4,
+            const size_t buffer_size = 1 << 22,
+            const bool is_io_uring_allowed = true);
+
+    ~AsynchronousFileInputSource() override;
+
+    AsynchronousFileInputSource(const AsynchronousFileInputSource&) = delete;
+    AsynchronousFileInputSource& operator=(const AsynchronousFileInputSource&) = delete;
+
+    bool ReadBlock(
+            StringView& block) override;
+
+    /*!
+    * Возвращает true, если чтения выполняются через io_uring.
+    */
+    bool IsUsingIoUring() const;
+
+private:
+    struct Buffer
+    {
+        char* data;
+        uint64_t offset;
+        size_t requested_size;
+        size_t filled_size;
+        bool is_complete;
+    };
+
+    static const size_t NoBuffer = static_cast<size_t>(-1);
+
+    // Отправляет чтение следующей части файла в свободный буфер.
+    void SubmitNextRead(
+            const size_t buffer_index);
+
+    // Ждет, пока буфер будет заполнен целиком или файл закончится.
+    void WaitForBuffer(
+            const size_t buffer_index);
+
+private:
+    uint64_t file_size_;
+    size_t buffer_size_;
+    uint64_t next_offset_;
+    // Отправленные, но еще не завершенные чтения.
+    size_t in_flight_reads_count_;
+    std::vector<char> storage_;
+    std::vector<Buffer> buffers_;
+    // Буферы с отправленными чтениями в порядке смещений.
+    std::deque<size_t> pending_buffer_indexes_;
+    // Буфер, блок из которого отдан разбору.
+    size_t current_buffer_index_;
+    // Незаконченная строка из конца предыдущего буфера.
+    std::string carry_;
+    // Склеенная строка, отданная разбору.
+    std::string joined_line_;
+    // Остаток текущего буфера, который будет отдан следующим вызовом.
+    StringView pending_block_;
+    std::unique_ptr<AsynchronousReader> reader_;
+};
+
+/*!
+* Форматы сжатия входных данных.
+*/
+enum class CompressionFormat
+{
+    None,
+    Gzip,
+    Zstd
+};
+
+/*!
+* Определяет формат сжатия по первым байтам данных.
+*/
+inline CompressionFormat DetectCompressionFormat(
+        const StringView header)
+{
+    if (header.Size() >= 2 &&
+            static_cast<unsigned char>(header[0]) == 0x1f &&
+            static_cast<unsigned char>(header[1]) == 0x8b)
+    {
+        return CompressionFormat::Gzip;
+    }
+
+    if (header.Size() >= 4 && std::memcmp(header.Data(), "\x28\xb5\x2f\xfd", 4) == 0)
+    {
+        return CompressionFormat::Zstd;
+    }
+
+    return CompressionFormat::None;
+}
+
+/*!
+* Способ чтения несжатых обычных файлов.
+*/
+enum class FileReadMode
+{
+    // Файл отображается в память целиком.
+    Mapped,
+    // Файл читается AsynchronousFileInputSource. Выгоднее, когда чтение
+    // медленное (сетевые тома): ожидание данных перекрывается разбором.
+    Asynchronous
+};
+
+/*!
+* Открывает источник входных данных. Несжатые обычные файлы отображаются в
+* память или читаются асинхронно, остальные (pipe, устройства, а также stdin,
+* заданный путем "-") читаются через буфер. Сжатые gzip и zstd данные
+* распаковываются в фоновом потоке без записи на диск.
+*
+\param[in] input_file_path Путь к файлу с входными данными.
+\param[in] file_read_mode Способ чтения несжатых обычных файлов.
+*
+\return Открытый источник данных.
+*/
+std::unique_ptr<InputSource> OpenInputSource(
+        const std::string& input_file_path,
+        const FileReadMode file_read_mode = FileReadMode::Mapped);
+
+/*!
+* Раскрывает шаблон пути (например, "*.gz" в каталоге logs) в список существующих файлов.
+* Если шаблону ничего не соответствует, возвращается он сам, чтобы ошибку
+* открытия файла можно было сообщить позже.
+*/
+std::vector<std::string> ExpandPathPattern(
+        const std::string& path_pattern);
+
+/*!
+* Раскрывает список входных файлов: шаблоны путей заменяются найденными
+* файлами, а аргумент "@список" - путями из файла "список" (по одному в
+* строке, пустые строки пропускаются, шаблоны допускаются).
+*
+\param[in] arguments Пути, шаблоны путей и ссылки на списки файлов.
+*
+\return Пути к входным файлам.
+*/
+std::vector<std::string> ExpandInputFilePaths(
+        const std::vector<std::string>& arguments);
+
+/*!
+* Идентификатор файла и его размер. По идентификатору определяется, что
+* файл под тем же путем был заменен новым (ротация логов).
+*/
+struct FileStatus
+{
+    uint64_t device = 0;
+    uint64_t index = 0;
+    uint64_t size = 0;
+
+    bool IsSameFile(
+            const FileStatus& other) const
+    {
+        return device == other.device && index == other.index;
+    }
+};
+
+/*!
+* Получает состояние открытого файла.
+*
+\return false если состояние получить не удалось.
+*/
+bool GetFileStatus(
+        FILE* file,
+        FileStatus& file_status);
+
+/*!
+* Получает состояние файла, находящегося по указанному пути.
+*
+\return false если файла нет или состояние получить не удалось.
+*/
+bool GetFileStatus(
+        const std::string& file_path,
+        FileStatus& file_status);
+
+/*!
+* Растущий файл (например, живой лог), из которого читаются только
+* дописанные с прошлого чтения целые строки. Незавершенная последняя строка
+* откладывается до появления перевода строки.
+*
+* Если файл под тем же путем заменен новым, сначала дочитывается старый файл,
+* затем новый читается с начала. Если файл укорочен (copytruncate), он
+* читается с начала.
+*/
+class FollowedFile
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] file_path Путь к несжатому файлу.
+    \param[in] buffer_size Размер буфера чтения.
+    */
+    explicit FollowedFile(
+            const std::string& file_path,
+            const size_t buffer_size = 1 << 20)
+        : file_path_(file_path)
+        , file_(nullptr)
+        , offset_(0)
+        , buffer_(buffer_size)
+        , carry_size_(0)
+    {
+        if (!Open())
+        {
+            throw std::invalid_argument(
+                    "FollowedFile : Can not open input file!");
+        }
+
+        char signature[4];
+        const size_t signature_size = std::fread(signature, 1, sizeof(signature), file_);
+        if (DetectCompressionFormat(StringView(signature, signature_size)) !=
+                CompressionFormat::None)
+        {
+            Close();
+            throw std::invalid_argument(
+                    "FollowedFile : Compressed input can not be followed!");
+        }
+
+        std::rewind(file_);
+    }
+
+    ~FollowedFile()
+    {
+        Close();
+    }
+
+    FollowedFile(const FollowedFile&) = delete;
+    FollowedFile& operator=(const FollowedFile&) = delete;
+
+    /*!
+    * Читает данные, дописанные с прошлого вызова, и передает обработчику
+    * блоки целых строк. Блок действителен только во время вызова обработчика.
+    *
+    \param[in] process_block Обработчик блоков.
+    *
+    \return Количество прочитанных байтов.
+    */
+    uint64_t ReadAppendedLines(
+            const std::function<void(StringView)>& process_block)
+    {
+        uint64_t read_size = 0;
+        if (file_ == nullptr && !Open())
+        {
+            // Между переименованием и созданием нового файла пути может не быть.
+            return read_size;
+        }
+
+        read_size += ReadToEnd(process_block);
+
+        FileStatus file_status;
+        if (!GetFileStatus(file_path_, file_status))
+        {
+            return read_size;
+        }
+
+        if (!file_status.IsSameFile(file_status_))
+        {
+            // Старый файл дочитан, его последняя строка больше не изменится.
+            FlushCarry(process_block);
+            Close();
+            if (Open())
+            {
+                read_size += ReadToEnd(process_block);
+            }
+        }
+        else if (file_status.size < offset_)
+        {
+            std::rewind(file_);
+            offset_ = 0;
+            carry_size_ = 0;
+            read_size += ReadToEnd(process_block);
+        }
+
+        return read_size;
+    }
+
+    /*!
+    * Возвращает количество байтов текущего файла, прочитанных с его начала.
+    */
+    uint64_t GetOffset() const
+    {
+        return offset_;
+    }
+
+private:
+    bool Open()
+    {
+        file_ = std::fopen(file_path_.c_str(), "rb");
+        if (file_ == nullptr)
+        {
+            return false;
+        }
+
+        if (!GetFileStatus(file_, file_status_))
+        {
+            Close();
+            return false;
+        }
+
+        offset_ = 0;
+        carry_size_ = 0;
+        return true;
+    }
+
+    void Close()
+    {
+        if (file_ != nullptr)
+        {
+            std::fclose(file_);
+            file_ = nullptr;
+        }
+    }
+
+    uint64_t ReadToEnd(
+            const std::function<void(StringView)>& process_block)
+    {
+        uint64_t read_size = 0;
+        for (;;)
+        {
+            if (carry_size_ == buffer_.size())
+            {
+                // Строка длиннее буфера.
+                buffer_.resize(buffer_.size() * 2);
+            }
+
+            const size_t chunk_size = std::fread(
+                    buffer_.data() + carry_size_,
+                    1,
+                    buffer_.size() - carry_size_,
+                    file_);
+            if (chunk_size == 0)
+            {
+                // Сбрасываем признак конца файла, чтобы прочитать дописанные позже данные.
+                std::clearerr(file_);
+                return read_size;
+            }
+
+            read_size += chunk_size;
+            offset_ += chunk_size;
+            const size_t filled_size = carry_size_ + chunk_size;
+            size_t lines_size = filled_size;
+            while (lines_size != 0 && buffer_[lines_size - 1] != '\n')
+            {
+                --lines_size;
+            }
+
+            if (lines_size != 0)
+            {
+                process_block(StringView(buffer_.data(), lines_size));
+                std::memmove(buffer_.data(), buffer_.data() + lines_size, filled_size - lines_size);
+            }
+
+            carry_size_ = filled_size - lines_size;
+        }
+    }
+
+    void FlushCarry(
+            const std::function<void(StringView)>& process_block)
+    {
+        if (carry_size_ != 0)
+        {
+            process_block(StringView(buffer_.data(), carry_size_));
+            carry_size_ = 0;
+        }
+    }
+
+private:
+    std::string file_path_;
+    FILE* file_;
+    FileStatus file_status_;
+    uint64_t offset_;
+    std::vector<char> buffer_;
+    size_t carry_size_;
+};
+
+/*!
+* Проверяет, можно ли подменить файл переименованием: файла еще нет или это
+* обычный файл (а не устройство, канал или /dev/stdout).
+*/
+bool IsReplaceableFile(
+        const std::string& file_path);
+
+/*!
+* Создает пустой временный файл с уникальным именем рядом с file_path
+* ("file_path.XXXXXX").
+*
+\return Путь к созданному файлу, пустая строка если создать не удалось.
+*/
+std::string CreateTemporaryFile(
+        const std::string& file_path);
+
+/*!
+* Заменяет файл target_file_path файлом source_file_path. Читатели видят
+* либо старое, либо новое содержимое целиком.
+*
+\return false если заменить не удалось.
+*/
+bool ReplaceFileAtomically(
+        const std::string& source_file_path,
+        const std::string& target_file_path);
@@ -0,0 +1,240 @@
+﻿#include "PathPrefixTree.h"
+
+#include <cstring>
+
+namespace
+{
+
+// Возвращает конец части пути, начинающейся с position: позицию после
+// очередного '/' или конец пути.
+size_t FindLabelEnd(
+        const StringView path,
+        const size_t position)
+{
+    const void* const slash = std::memchr(path.Data() + position, '/', path.Size() - position);
+    return slash == nullptr
+            ? path.Size()
+            : static_cast<const char*>(slash) - path.Data() + 1;
+}
+
+uint32_t HashLabel(
+        const size_t parent_index,
+        const StringView label)
+{
+    const uint64_t hash =
+            HashBytes(label.Data(), label.Size()) ^ (parent_index * 0x9e3779b97f4a7c15ULL);
+    return static_cast<uint32_t>(hash ^ (hash >> 32));
+}
+
+} // namespace
+
+PathPrefixTree::PathPrefixTree()
+    : nodes_(1, Node{StringView(), 0, 0, 0})
+    , slots_(16)
+{
+}
+
+void PathPrefixTree::Add(
+        const StringView path,
+        const size_t count)
+{
+    nodes_.front().count += count;
+    size_t node_index = 0;
+    for (size_t label_begin = 0; label_begin != path.Size(); )
+    {
+        const size_t label_end = FindLabelEnd(path, label_begin);
+        node_index = FindOrAddChild(
+                node_index,
+                path.Substring(label_begin, label_end - label_begin));
+        nodes_[node_index].count += count;
+        label_begin = label_end;
+    }
+}
+
+void PathPrefixTree::Merge(
+        const PathPrefixTree& other)
+{
+    // Родитель создается раньше детей, поэтому его номер в этом дереве
+    // известен к моменту обхода ребенка.
+    std::vector<uint32_t> node_indices(other.nodes_.size(), 0);
+    nodes_.front().count += other.nodes_.front().count;
+    for (size_t i = 1; i < other.nodes_.size(); ++i)
+    {
+        const Node& other_node = other.nodes_[i];
+        const size_t node_index = FindOrAddChild(
+                node_indices[other_node.parent_index],
+                other_node.label);
+        nodes_[node_index].count += other_node.count;
+        node_indices[i] = static_cast<uint32_t>(node_index);
+    }
+}
+
+std::vector<size_t> PathPrefixTree::GetDepthNodes(
+        const size_t depth) const
+{
+    std::vector<size_t> node_indices;
+    for (size_t i = 1; i < nodes_.size(); ++i)
+    {
+        if (nodes_[i].depth == depth)
+        {
+            node_indices.push_back(i);
+        }
+    }
+
+    return node_indices;
+}
+
+std::vector<size_t> PathPrefixTree::GetChildNodes(
+        const StringView prefix) const
+{
+    std::vector<size_t> node_indices;
+    size_t parent_index = 0;
+    for (size_t label_begin = 0; label_begin != prefix.Size(); )
+    {
+        const size_t label_end = FindLabelEnd(prefix, label_begin);
+        parent_index = FindChild(
+                parent_index,
+                prefix.Substring(label_begin, label_end - label_begin));
+        if (parent_index == nodes_.size())
+        {
+            return node_indices;
+        }
+
+        label_begin = label_end;
+    }
+
+    for (size_t i = 1; i < nodes_.size(); ++i)
+    {
+        if (nodes_[i].parent_index == parent_index)
+        {
+            node_indices.push_back(i);
+        }
+    }
+
+    return node_indices;
+}
+
+std::vector<KeyCountHandle> PathPrefixTree::GetHandles(
+        const std::vector<size_t>& node_indices,
+        StringArena& arena) const
+{
+    std::vector<KeyCountHandle> handles;
+    handles.reserve(node_indices.size());
+    std::vector<StringView> labels;
+    std::string prefix;
+    for (const size_t node_index : node_indices)
+    {
+        labels.clear();
+        for (size_t i = node_index; i != 0; i = nodes_[i].parent_index)
+        {
+            labels.push_back(nodes_[i].label);
+        }
+
+        prefix.clear();
+        for (auto label = labels.rbegin(); label != labels.rend(); ++label)
+        {
+            prefix.append(label->Data(), label->Size());
+        }
+
+        handles.push_back(KeyCountHandle{arena.Store(StringView(prefix)), nodes_[node_index].count});
+    }
+
+    return handles;
+}
+
+size_t PathPrefixTree::GetMemoryUsage() const
+{
+    return nodes_.capacity() * sizeof(Node) +
+            slots_.capacity() * sizeof(Slot) +
+            arena_.GetAllocatedSize();
+}
+
+size_t PathPrefixTree::FindChild(
+        const size_t parent_index,
+        const StringView label) const
+{
+    const uint32_t hash = HashLabel(parent_index, label);
+    const size_t mask = slots_.size() - 1;
+
+    for (size_t slot_index = hash & mask; ; slot_index = (slot_index + 1) & mask)
+    {
+        const Slot& slot = slots_[slot_index];
+        if (slot.node_number == 0)
+        {
+            return nodes_.size();
+        }
+
+        if (slot.hash == hash)
+        {
+            const Node& node = nodes_[slot.node_number - 1];
+            if (node.parent_index == parent_index &&
+                    node.label.Size() == label.Size() &&
+                    std::memcmp(node.label.Data(), label.Data(), label.Size()) == 0)
+            {
+                return slot.node_number - 1;
+            }
+        }
+    }
+}
+
+size_t PathPrefixTree::FindOrAddChild(
+        const size_t parent_index,
+        const StringView label)
+{
+    const size_t child_index = FindChild(parent_index, label);
+    if (child_index != nodes_.size())
+    {
+        return child_index;
+    }
+
+    const Node& parent = nodes_[parent_index];
+    const bool is_parent_directory =
+            parent_index != 0 && parent.label[parent.label.Size() - 1] == '/';
+    const uint32_t depth = parent.depth + (is_parent_directory ? 1 : 0);
+    nodes_.push_back(Node{
+            arena_.Store(label),
+            0,
+            static_cast<uint32_t>(parent_index),
+            depth});
+
+    const uint32_t hash = HashLabel(parent_index, label);
+    const size_t mask = slots_.size() - 1;
+    size_t slot_index = hash & mask;
+    while (slots_[slot_index].node_number != 0)
+    {
+        slot_index = (slot_index + 1) & mask;
+    }
+
+    slots_[slot_index].hash = hash;
+    slots_[slot_index].node_number = static_cast<uint32_t>(nodes_.size());
+    if (nodes_.size() * 10 > slots_.size() * 7)
+    {
+        Rehash(slots_.size() * 2);
+    }
+
+    return child_index;
+}
+
+void PathPrefixTree::Rehash(
+        const size_t slots_count)
+{
+    std::vector<Slot> slots(slots_count);
+    const size_t mask = slots_count - 1;
+    for (const Slot& slot : slots_)
+    {
+        if (slot.node_number == 0)
+        {
+            continue;
+        }
+
+        size_t slot_index = slot.hash & mask;
+        while (slots[slot_index].node_number != 0)
+        {
+            slot_index = (slot_index + 1) & mask;
+        }
+
+        slots[slot_index] = slot;
+    }
+
+    slots_.swap(slots);
+}
@@ -0,0 +1,114 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "StringView.h"
+#include "Counters.h"
+
+/*!
+* Сжатое дерево префиксов путей. Путь делится на части после каждого '/':
+* "/wiki/Main_Page" -> "/", "wiki/", "Main_Page". Ребро дерева - целая часть
+* пути, а не символ, поэтому узлы есть только на границах каталогов. Счетчик
+* узла - количество URL-ов, путь которых начинается его префиксом.
+*
+* Общие префиксы хранятся один раз: узел хранит только свою часть пути в
+* арене и номер родителя. Дерево заполняется по мере разбора.
+*/
+class PathPrefixTree
+{
+public:
+    struct Node
+    {
+        // Часть пути от префикса родителя до конца префикса узла.
+        StringView label;
+        size_t count;
+        uint32_t parent_index;
+        // Глубина префикса: количество '/' в нем без последнего символа.
+        // "/" - 0, "/wiki/" и "/favicon.ico" - 1, "/w/index.php" - 2.
+        uint32_t depth;
+    };
+
+    PathPrefixTree();
+
+    PathPrefixTree(PathPrefixTree&&) = default;
+    PathPrefixTree& operator=(PathPrefixTree&&) = default;
+
+    /*!
+    * Увеличивает счетчики всех префиксов пути.
+    */
+    void Add(
+            const StringView path,
+            const size_t count = 1);
+
+    /*!
+    * Добавляет счетчики другого дерева за один проход по его узлам.
+    */
+    void Merge(
+            const PathPrefixTree& other);
+
+    /*!
+    * Возвращает номера узлов глубины depth.
+    */
+    std::vector<size_t> GetDepthNodes(
+            const size_t depth) const;
+
+    /*!
+    * Возвращает номера узлов, непосредственно продолжающих префикс prefix
+    * (например, страницы и подкаталоги "/wiki/"). Префикс должен
+    * заканчиваться на границе части пути, иначе результат пуст.
+    */
+    std::vector<size_t> GetChildNodes(
+            const StringView prefix) const;
+
+    /*!
+    * Возвращает ссылки на префиксы узлов и их счетчики. Префиксы собираются
+    * из частей и копируются в arena.
+    */
+    std::vector<KeyCountHandle> GetHandles(
+            const std::vector<size_t>& node_indices,
+            StringArena& arena) const;
+
+    const std::vector<Node>& GetNodes() const
+    {
+        return nodes_;
+    }
+
+    /*!
+    * Возвращает объем памяти в байтах, занимаемый узлами, индексом и ареной.
+    */
+    size_t GetMemoryUsage() const;
+
+private:
+    struct Slot
+    {
+        uint32_t hash = 0;
+        // Номер узла, увеличенный на единицу. 0 - ячейка свободна.
+        uint32_t node_number = 0;
+    };
+
+    /*!
+    * Возвращает номер дочернего узла parent_index с частью label или
+    * nodes_.size(), если его нет.
+    */
+    size_t FindChild(
+            const size_t parent_index,
+            const StringView label) const;
+
+    /*!
+    * Возвращает номер дочернего узла, создавая его при первой встрече.
+    */
+    size_t FindOrAddChild(
+            const size_t parent_index,
+            const StringView label);
+
+    void Rehash(
+            const size_t slots_count);
+
+private:
+    std::vector<Node> nodes_;
+    // Индекс детей по паре (родитель, часть пути), общий для всех узлов.
+    std::vector<Slot> slots_;
+    StringArena arena_;
+};
@@ -0,0 +1,147 @@
+﻿#include "Snapshot.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <memory>
+
+bool IsSnapshotFile(
+        const std::string& file_path)
+{
+    if (file_path == "-")
+    {
+        return false;
+    }
+
+    FILE* file = std::fopen(file_path.c_str(), "rb");
+    if (file == nullptr)
+    {
+        return false;
+    }
+
+    char signature[sizeof(snapshot_signature)];
+    const bool is_snapshot =
+            std::fread(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+            std::memcmp(signature, snapshot_signature, sizeof(signature)) == 0;
+    std::fclose(file);
+    return is_snapshot;
+}
+
+/*!
+* Сливает упорядоченные разделы снимков k-путевым слиянием: счетчики
+* одинаковых ключей складываются. В памяти одновременно находится по одной
+* записи каждого раздела.
+*/
+inline void MergeSnapshotSections(
+        std::vector<SnapshotSectionCursor> cursors,
+        SnapshotWriter& snapshot_writer)
+{
+    struct CursorHead
+    {
+        StringView key;
+        size_t count;
+        size_t cursor_index;
+    };
+
+    // Куча с наименьшим ключом в вершине.
+    const auto is_greater = [](const CursorHead& left, const CursorHead& right)
+    {
+        return CompareBytes(left.key, right.key) > 0;
+    };
+
+    std::vector<CursorHead> heads;
+    for (size_t i = 0; i < cursors.size(); ++i)
+    {
+        CursorHead head{StringView(), 0, i};
+        if (cursors[i].Next(head.key, head.count))
+        {
+            heads.push_back(head);
+        }
+    }
+
+    std::make_heap(heads.begin(), heads.end(), is_greater);
+    while (!heads.empty())
+    {
+        const StringView key = heads.front().key;
+        size_t count = 0;
+        while (!heads.empty() && CompareBytes(heads.front().key, key) == 0)
+        {
+            std::pop_heap(heads.begin(), heads.end(), is_greater);
+            CursorHead& head = heads.back();
+            count += head.count;
+            if (cursors[head.cursor_index].Next(head.key, head.count))
+            {
+                std::push_heap(heads.begin(), heads.end(), is_greater);
+            }
+            else
+            {
+                heads.pop_back();
+            }
+        }
+
+        snapshot_writer.AddRecord(key, count);
+    }
+}
+
+void MergeSnapshots(
+        const std::vector<std::string>& snapshot_file_paths,
+        const std::string& output_snapshot_file_path)
+{
+    std::vector<std::unique_ptr<SnapshotReader>> snapshot_readers;
+    size_t urls_count = 0;
+    for (const std::string& snapshot_file_path : snapshot_file_paths)
+    {
+        snapshot_readers.emplace_back(new SnapshotReader(snapshot_file_path));
+        urls_count += snapshot_readers.back()->GetUrlsCount();
+    }
+
+    // Результат может оказаться среди отображенных входных снимков, поэтому
+    // он пишется во временный файл и подменяет прежний после закрытия входных.
+    const bool is_replaced_atomically = IsReplaceableFile(output_snapshot_file_path);
+    const std::string written_file_path = is_replaced_atomically
+            ? CreateTemporaryFile(output_snapshot_file_path)
+            : output_snapshot_file_path;
+    if (written_file_path.empty())
+    {
+        throw std::invalid_argument(
+                "MergeSnapshots : Can not open output snapshot file!");
+    }
+
+    try
+    {
+        SnapshotWriter snapshot_writer(written_file_path);
+        std::vector<SnapshotSectionCursor> cursors;
+        for (const auto& snapshot_reader : snapshot_readers)
+        {
+            cursors.push_back(snapshot_reader->GetDomains());
+        }
+
+        MergeSnapshotSections(cursors, snapshot_writer);
+        snapshot_writer.FinishDomains();
+
+        cursors.clear();
+        for (const auto& snapshot_reader : snapshot_readers)
+        {
+            cursors.push_back(snapshot_reader->GetPaths());
+        }
+
+        MergeSnapshotSections(cursors, snapshot_writer);
+        snapshot_writer.Finish(urls_count);
+        snapshot_readers.clear();
+
+        if (is_replaced_atomically &&
+                !ReplaceFileAtomically(written_file_path, output_snapshot_file_path))
+        {
+            throw std::invalid_argument(
+                    "MergeSnapshots : Can not replace output snapshot file!");
+        }
+    }
+    catch (...)
+    {
+        if (is_replaced_atomically)
+        {
+            std::remove(written_file_path.c_str());
+        }
+
+        throw;
+    }
+}
@@ -0,0 +1,408 @@
+﻿#pragma once
+
+#include <string>
+#include <fstream>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include "StringView.h"
+#include "InputSource.h"
+
+/*!
+* Формат снимка статистики (все числа - little-endian):
+* - заголовок размером snapshot_header_size байт: сигнатура, версия,
+*   количество URL-ов, количества доменов и путей, размеры разделов и
+*   контрольная сумма данных после заголовка;
+* - раздел доменов, затем раздел путей. Раздел - словарь строк: записи
+*   "varint длина ключа, байты ключа, varint счетчик", ключи уникальны и
+*   упорядочены функцией CompareBytes.
+*
+* Снимок читается прямо из отображенного в память файла: ключи отдаются
+* ссылками на его данные, а упорядоченность разделов позволяет сливать
+* снимки потоково.
+*/
+const char snapshot_signature[8] = {'U', 'R', 'L', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t snapshot_version = 1;
+const size_t snapshot_header_size = 64;
+// Контрольная сумма считается по частям этого размера.
+const size_t snapshot_checksum_chunk_size = 1 << 16;
+
+inline void StoreUint64(
+        char* destination,
+        uint64_t value)
+{
+    for (size_t i = 0; i < 8; ++i, value >>= 8)
+    {
+        destination[i] = static_cast<char>(value & 0xff);
+    }
+}
+
+inline uint64_t LoadUint64(
+        const char* source)
+{
+    uint64_t value = 0;
+    for (size_t i = 8; i != 0; --i)
+    {
+        value = (value << 8) | static_cast<unsigned char>(source[i - 1]);
+    }
+
+    return value;
+}
+
+/*!
+* Добавляет к контрольной сумме хеш очередной части данных.
+*/
+inline uint64_t UpdateSnapshotChecksum(
+        const uint64_t checksum,
+        const char* data,
+        const size_t size)
+{
+    return (checksum ^ HashBytes(data, size)) * 0x9e3779b97f4a7c15ULL;
+}
+
+/*!
+* Проверяет, начинается ли файл с сигнатуры снимка статистики.
+*
+\param[in] file_path Путь к файлу. "-" (stdin) снимком не считается.
+*/
+bool IsSnapshotFile(
+        const std::string& file_path);
+
+/*!
+* Последовательно записывает снимок статистики. Записи раздела должны
+* поступать в порядке возрастания ключей, сначала домены, затем пути.
+*/
+class SnapshotWriter
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] snapshot_file_path Путь к создаваемому файлу снимка.
+    */
+    explicit SnapshotWriter(
+            const std::string& snapshot_file_path)
+        : snapshot_file_(snapshot_file_path, std::ios::out | std::ios::binary | std::ios::trunc)
+        , current_section_(0)
+        , checksum_(0)
+        , is_finished_(false)
+    {
+        if (!snapshot_file_.is_open())
+        {
+            throw std::invalid_argument(
+                    "SnapshotWriter : Can not open snapshot file!");
+        }
+
+        // Заголовок записывается в конце, когда известны размеры разделов.
+        const std::string header_placeholder(snapshot_header_size, '\0');
+        snapshot_file_.write(header_placeholder.data(), header_placeholder.size());
+        for (size_t i = 0; i < 2; ++i)
+        {
+            keys_counts_[i] = 0;
+            sections_sizes_[i] = 0;
+        }
+    }
+
+    /*!
+    * Добавляет запись в текущий раздел.
+    */
+    void AddRecord(
+            const StringView key,
+            const size_t count)
+    {
+        if (keys_counts_[current_section_] != 0 &&
+                CompareBytes(StringView(previous_key_), key) >= 0)
+        {
+            throw std::invalid_argument(
+                    "SnapshotWriter : Keys must be unique and sorted!");
+        }
+
+        const size_t record_begin = buffer_.size();
+        AppendVarint(key.Size());
+        buffer_.append(key.Data(), key.Size());
+        AppendVarint(count);
+        sections_sizes_[current_section_] += buffer_.size() - record_begin;
+        ++keys_counts_[current_section_];
+        previous_key_.assign(key.Data(), key.Size());
+
+        if (buffer_.size() >= 16 * snapshot_checksum_chunk_size)
+        {
+            Flush(false);
+        }
+    }
+
+    /*!
+    * Завершает раздел доменов, следующие записи попадут в раздел путей.
+    */
+    void FinishDomains()
+    {
+        if (current_section_ != 0)
+        {
+            throw std::invalid_argument(
+                    "SnapshotWriter : Domains are already finished!");
+        }
+
+        current_section_ = 1;
+    }
+
+    /*!
+    * Дописывает оставшиеся данные и заголовок.
+    *
+    \param[in] urls_count Общее количество URL-ов.
+    */
+    void Finish(
+            const size_t urls_count)
+    {
+        if (current_section_ != 1 || is_finished_)
+        {
+            throw std::invalid_argument(
+                    "SnapshotWriter : Domains must be finished before snapshot!");
+        }
+
+        Flush(true);
+
+        char header[snapshot_header_size] = {};
+        std::memcpy(header, snapshot_signature, sizeof(snapshot_signature));
+        StoreUint64(header + 8, snapshot_version);
+        StoreUint64(header + 16, urls_count);
+        StoreUint64(header + 24, keys_counts_[0]);
+        StoreUint64(header + 32, keys_counts_[1]);
+        StoreUint64(header + 40, sections_sizes_[0]);
+        StoreUint64(header + 48, sections_sizes_[1]);
+        StoreUint64(header + 56, checksum_);
+        snapshot_file_.seekp(0);
+        snapshot_file_.write(header, sizeof(header));
+        snapshot_file_.close();
+        is_finished_ = true;
+
+        if (snapshot_file_.fail())
+        {
+            throw std::invalid_argument(
+                    "SnapshotWriter : Can not write snapshot file!");
+        }
+    }
+
+private:
+    void AppendVarint(
+            uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            buffer_.push_back(static_cast<char>((value & 0x7f) | 0x80));
+            value >>= 7;
+        }
+
+        buffer_.push_back(static_cast<char>(value));
+    }
+
+    /*!
+    * Записывает накопленные данные. Пока снимок не завершен, записываются
+    * только целые части контрольной суммы.
+    */
+    void Flush(
+            const bool is_last)
+    {
+        const size_t flushed_size = is_last
+                ? buffer_.size()
+                : buffer_.size() / snapshot_checksum_chunk_size * snapshot_checksum_chunk_size;
+        for (size_t offset = 0; offset < flushed_size; offset += snapshot_checksum_chunk_size)
+        {
+            checksum_ = UpdateSnapshotChecksum(
+                    checksum_,
+                    buffer_.data() + offset,
+                    std::min(snapshot_checksum_chunk_size, flushed_size - offset));
+        }
+
+        snapshot_file_.write(buffer_.data(), flushed_size);
+        buffer_.erase(0, flushed_size);
+    }
+
+private:
+    std::ofstream snapshot_file_;
+    std::string buffer_;
+    std::string previous_key_;
+    size_t current_section_;
+    size_t keys_counts_[2];
+    size_t sections_sizes_[2];
+    uint64_t checksum_;
+    bool is_finished_;
+};
+
+/*!
+* Последовательный обход записей раздела снимка. Ключи ссылаются на данные
+* снимка и не копируются.
+*/
+class SnapshotSectionCursor
+{
+public:
+    explicit SnapshotSectionCursor(
+            const StringView section = StringView())
+        : current_(section.Data())
+        , end_(section.Data() + section.Size())
+    {
+    }
+
+    /*!
+    * Читает очередную запись.
+    *
+    \return true если запись прочитана, false если раздел закончился.
+    */
+    bool Next(
+            StringView& key,
+            size_t& count)
+    {
+        if (current_ == end_)
+        {
+            return false;
+        }
+
+        const uint64_t key_size = ReadVarint();
+        if (key_size > static_cast<uint64_t>(end_ - current_))
+        {
+            throw std::invalid_argument(
+                    "SnapshotReader : Snapshot is corrupted!");
+        }
+
+        key = StringView(current_, static_cast<size_t>(key_size));
+        current_ += key_size;
+        count = static_cast<size_t>(ReadVarint());
+        return true;
+    }
+
+private:
+    uint64_t ReadVarint()
+    {
+        uint64_t value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7)
+        {
+            if (current_ == end_)
+            {
+                break;
+            }
+
+            const unsigned char byte = static_cast<unsigned char>(*current_++);
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+            {
+                return value;
+            }
+        }
+
+        throw std::invalid_argument(
+                "SnapshotReader : Snapshot is corrupted!");
+    }
+
+private:
+    const char* current_;
+    const char* end_;
+};
+
+/*!
+* Снимок статистики, отображенный в память. При открытии проверяются
+* заголовок и контрольная сумма, записи разбираются только при обходе.
+*/
+class SnapshotReader
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] snapshot_file_path Путь к файлу снимка.
+    */
+    explicit SnapshotReader(
+            const std::string& snapshot_file_path)
+        : mapped_file_(snapshot_file_path)
+    {
+        StringView data;
+        mapped_file_.ReadBlock(data);
+        if (data.Size() < snapshot_header_size ||
+                std::memcmp(data.Data(), snapshot_signature, sizeof(snapshot_signature)) != 0)
+        {
+            throw std::invalid_argument(
+                    "SnapshotReader : File is not a snapshot!");
+        }
+
+        if (LoadUint64(data.Data() + 8) != snapshot_version)
+        {
+            throw std::invalid_argument(
+                    "SnapshotReader : Unsupported snapshot version!");
+        }
+
+        urls_count_ = static_cast<size_t>(LoadUint64(data.Data() + 16));
+        domains_count_ = static_cast<size_t>(LoadUint64(data.Data() + 24));
+        paths_count_ = static_cast<size_t>(LoadUint64(data.Data() + 32));
+        const uint64_t domains_size = LoadUint64(data.Data() + 40);
+        const uint64_t paths_size = LoadUint64(data.Data() + 48);
+        const uint64_t data_size = data.Size() - snapshot_header_size;
+        if (domains_size > data_size ||
+                paths_size != data_size - domains_size)
+        {
+            throw std::invalid_argument(
+                    "SnapshotReader : Snapshot is corrupted!");
+        }
+
+        uint64_t checksum = 0;
+        for (size_t offset = 0; offset < data_size; offset += snapshot_checksum_chunk_size)
+        {
+            checksum = UpdateSnapshotChecksum(
+                    checksum,
+                    data.Data() + snapshot_header_size + offset,
+                    std::min<size_t>(snapshot_checksum_chunk_size, data_size - offset));
+        }
+
+        if (checksum != LoadUint64(data.Data() + 56))
+        {
+            throw std::invalid_argument(
+                    "SnapshotReader : Snapshot checksum mismatch!");
+        }
+
+        domains_ = data.Substring(snapshot_header_size, domains_size);
+        paths_ = data.Substring(snapshot_header_size + domains_size, paths_size);
+    }
+
+    size_t GetUrlsCount() const
+    {
+        return urls_count_;
+    }
+
+    size_t GetDomainsCount() const
+    {
+        return domains_count_;
+    }
+
+    size_t GetPathsCount() const
+    {
+        return paths_count_;
+    }
+
+    SnapshotSectionCursor GetDomains() const
+    {
+        return SnapshotSectionCursor(domains_);
+    }
+
+    SnapshotSectionCursor GetPaths() const
+    {
+        return SnapshotSectionCursor(paths_);
+    }
+
+private:
+    MappedFileInputSource mapped_file_;
+    size_t urls_count_;
+    size_t domains_count_;
+    size_t paths_count_;
+    StringView domains_;
+    StringView paths_;
+};
+
+/*!
+* Сливает несколько снимков статистики в один. Снимки читаются потоково,
+* поэтому память не зависит от количества ключей в них.
+*
+\param[in] snapshot_file_paths Пути к сливаемым снимкам.
+\param[in] output_snapshot_file_path Путь к результирующему снимку.
+*/
+void MergeSnapshots(
+        const std::vector<std::string>& snapshot_file_paths,
+        const std::string& output_snapshot_file_path);
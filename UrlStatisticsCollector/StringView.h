@@ -0,0 +1,189 @@
+﻿#pragma once
+
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+
+/*!
+* Невладеющая ссылка на непрерывный участок символов (аналог std::string_view из C++17).
+*/
+class StringView
+{
+public:
+    StringView()
+        : data_(nullptr)
+        , size_(0)
+    {
+    }
+
+    StringView(
+            const char* data,
+            const size_t size)
+        : data_(data)
+        , size_(size)
+    {
+    }
+
+    StringView(
+            const std::string& data)
+        : data_(data.data())
+        , size_(data.size())
+    {
+    }
+
+    const char* Data() const
+    {
+        return data_;
+    }
+
+    size_t Size() const
+    {
+        return size_;
+    }
+
+    bool Empty() const
+    {
+        return size_ == 0;
+    }
+
+    char operator[](
+            const size_t position) const
+    {
+        return data_[position];
+    }
+
+    /*!
+    * Возвращает часть строки длиной count, начиная с позиции position.
+    */
+    StringView Substring(
+            const size_t position,
+            const size_t count) const
+    {
+        return StringView(data_ + position, count);
+    }
+
+    std::string ToString() const
+    {
+        return std::string(data_, size_);
+    }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+/*!
+* Вычисляет 64-битный хеш последовательности байтов (вариант MurmurHash64A).
+* Данные читаются словами по 8 байт.
+*/
+inline uint64_t HashBytes(
+        const char* data,
+        const size_t size)
+{
+    const uint64_t multiplier = 0xc6a4a7935bd1e995ULL;
+    const int shift = 47;
+    uint64_t hash = 0x9e3779b97f4a7c15ULL ^ (size * multiplier);
+
+    const char* const words_end = data + size / 8 * 8;
+    for (; data != words_end; data += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data, 8);
+        word *= multiplier;
+        word ^= word >> shift;
+        word *= multiplier;
+        hash ^= word;
+        hash *= multiplier;
+    }
+
+    const size_t rest_size = size & 7;
+    if (rest_size != 0)
+    {
+        uint64_t word = 0;
+        std::memcpy(&word, data, rest_size);
+        hash ^= word;
+        hash *= multiplier;
+    }
+
+    hash ^= hash >> shift;
+    hash *= multiplier;
+    hash ^= hash >> shift;
+    return hash;
+}
+
+inline bool operator==(
+        const StringView left,
+        const StringView right)
+{
+    return left.Size() == right.Size() &&
+            std::memcmp(left.Data(), right.Data(), left.Size()) == 0;
+}
+
+struct StringViewHash
+{
+    size_t operator()(
+            const StringView data) const
+    {
+        return static_cast<size_t>(HashBytes(data.Data(), data.Size()));
+    }
+};
+
+inline unsigned char ToLowerCaseSymbol(
+        const char symbol)
+{
+    const unsigned char code = static_cast<unsigned char>(symbol);
+    return code >= 'A' && code <= 'Z' ? code + ('a' - 'A') : code;
+}
+
+/*!
+* Сравнивает строки без учета регистра латиницы, а при равенстве - побайтово.
+* Память не выделяется.
+*
+\return Отрицательное число, ноль или положительное число, если left меньше,
+* равна или больше right.
+*/
+inline int CompareCaseInsensitive(
+        const StringView left,
+        const StringView right)
+{
+    const size_t common_size = std::min(left.Size(), right.Size());
+    for (size_t i = 0; i < common_size; ++i)
+    {
+        const unsigned char left_symbol = ToLowerCaseSymbol(left[i]);
+        const unsigned char right_symbol = ToLowerCaseSymbol(right[i]);
+        if (left_symbol != right_symbol)
+        {
+            return left_symbol < right_symbol ? -1 : 1;
+        }
+    }
+
+    if (left.Size() != right.Size())
+    {
+        return left.Size() < right.Size() ? -1 : 1;
+    }
+
+    // Ключи, различающиеся только регистром, упорядочиваем побайтово,
+    // чтобы результат не зависел от порядка обхода таблицы.
+    return std::memcmp(left.Data(), right.Data(), common_size);
+}
+
+/*!
+* Сравнивает строки побайтово (как беззнаковые символы), более короткий
+* префикс меньше. В этом порядке ключи хранятся в снимках статистики.
+*/
+inline int CompareBytes(
+        const StringView left,
+        const StringView right)
+{
+    const size_t common_size = std::min(left.Size(), right.Size());
+    const int result = common_size == 0
+            ? 0
+            : std::memcmp(left.Data(), right.Data(), common_size);
+    if (result != 0 || left.Size() == right.Size())
+    {
+        return result;
+    }
+
+    return left.Size() < right.Size() ? -1 : 1;
+}
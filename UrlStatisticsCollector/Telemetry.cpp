@@ -0,0 +1,129 @@
+﻿#include "Telemetry.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <time.h>
+#endif
+
+namespace
+{
+
+const char* const stage_names[telemetry_stages_count] =
+{
+    "read",
+    "parse",
+    "merge",
+    "report"
+};
+
+} // namespace
+
+void Telemetry::Add(
+        const Telemetry& other)
+{
+    bytes_count += other.bytes_count;
+    lines_count += other.lines_count;
+    url_candidates_count += other.url_candidates_count;
+    urls_count += other.urls_count;
+    hash_probes_count += other.hash_probes_count;
+    rehashes_count += other.rehashes_count;
+    arena_size += other.arena_size;
+    for (size_t i = 0; i < telemetry_stages_count; ++i)
+    {
+        stage_times[i].wall_nanoseconds += other.stage_times[i].wall_nanoseconds;
+        stage_times[i].cpu_nanoseconds += other.stage_times[i].cpu_nanoseconds;
+        stage_times[i].calls_count += other.stage_times[i].calls_count;
+    }
+}
+
+void Telemetry::WriteText(
+        std::ostream& output) const
+{
+    if (!IsEnabled())
+    {
+        output << "telemetry is disabled in this build" << std::endl;
+        return;
+    }
+
+    output <<
+            "telemetry" << std::endl <<
+            "bytes " << bytes_count <<
+            ", lines " << lines_count <<
+            ", url candidates " << url_candidates_count <<
+            ", urls " << urls_count << std::endl <<
+            "hash probes " << hash_probes_count <<
+            ", rehashes " << rehashes_count <<
+            ", arena bytes " << arena_size << std::endl;
+
+    for (size_t i = 0; i < telemetry_stages_count; ++i)
+    {
+        output <<
+                "stage " << stage_names[i] <<
+                ": wall " << stage_times[i].wall_nanoseconds / 1000000.0 <<
+                " ms, cpu " << stage_times[i].cpu_nanoseconds / 1000000.0 <<
+                " ms, calls " << stage_times[i].calls_count << std::endl;
+    }
+}
+
+void Telemetry::WriteJson(
+        std::ostream& output) const
+{
+    output << "{\"enabled\":" << (IsEnabled() ? "true" : "false");
+    if (IsEnabled())
+    {
+        output <<
+                ",\"bytes\":" << bytes_count <<
+                ",\"lines\":" << lines_count <<
+                ",\"url_candidates\":" << url_candidates_count <<
+                ",\"urls\":" << urls_count <<
+                ",\"hash_probes\":" << hash_probes_count <<
+                ",\"rehashes\":" << rehashes_count <<
+                ",\"arena_bytes\":" << arena_size <<
+                ",\"stages\":{";
+        for (size_t i = 0; i < telemetry_stages_count; ++i)
+        {
+            output <<
+                    (i == 0 ? "" : ",") << '"' << stage_names[i] << "\":{" <<
+                    "\"wall_ns\":" << stage_times[i].wall_nanoseconds <<
+                    ",\"cpu_ns\":" << stage_times[i].cpu_nanoseconds <<
+                    ",\"calls\":" << stage_times[i].calls_count << '}';
+        }
+
+        output << '}';
+    }
+
+    output << '}' << std::endl;
+}
+
+uint64_t GetThreadCpuTime()
+{
+#if defined(_WIN32)
+    FILETIME creation_time;
+    FILETIME exit_time;
+    FILETIME kernel_time;
+    FILETIME user_time;
+    if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+    {
+        return 0;
+    }
+
+    // FILETIME измеряется в интервалах по 100 наносекунд.
+    const auto to_nanoseconds = [](const FILETIME& time)
+    {
+        return ((static_cast<uint64_t>(time.dwHighDateTime) << 32) | time.dwLowDateTime) * 100;
+    };
+
+    return to_nanoseconds(kernel_time) + to_nanoseconds(user_time);
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    timespec time;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0)
+    {
+        return 0;
+    }
+
+    return static_cast<uint64_t>(time.tv_sec) * 1000000000 + static_cast<uint64_t>(time.tv_nsec);
+#else
+    return 0;
+#endif
+}
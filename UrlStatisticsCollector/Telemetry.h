@@ -0,0 +1,150 @@
+﻿#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Счетчики телеметрии увеличиваются, только если при сборке задан
+// URL_STATISTICS_TELEMETRY; иначе макрос ничего не делает.
+#if defined(URL_STATISTICS_TELEMETRY)
+#define URL_STATISTICS_TELEMETRY_ADD(counter, value) ((counter) += (value))
+#else
+#define URL_STATISTICS_TELEMETRY_ADD(counter, value) static_cast<void>(0)
+#endif
+
+/*!
+* Этапы сбора статистики, время которых измеряется отдельно.
+*/
+enum class TelemetryStage
+{
+    // Ожидание очередного блока входных данных (чтение, распаковка).
+    Read,
+    // Поиск URL-ов и обновление таблиц счетчиков.
+    Parse,
+    // Слияние статистик, собранных потоками.
+    Merge,
+    // Отбор top-N и запись отчета.
+    Report
+};
+
+const size_t telemetry_stages_count = 4;
+
+/*!
+* Время, затраченное на этап.
+*/
+struct StageTime
+{
+    uint64_t wall_nanoseconds = 0;
+    uint64_t cpu_nanoseconds = 0;
+    uint64_t calls_count = 0;
+};
+
+/*!
+* Телеметрия сбора статистики. Время этапов, выполняемых несколькими потоками
+* одновременно, суммируется по потокам.
+*/
+struct Telemetry
+{
+    // Разобранные байты и строки входных данных.
+    uint64_t bytes_count = 0;
+    uint64_t lines_count = 0;
+    // Найденные префиксы URL-ов и URL-ы, попавшие в статистику.
+    uint64_t url_candidates_count = 0;
+    uint64_t urls_count = 0;
+    // Просмотренные ячейки и перестройки точных таблиц счетчиков.
+    uint64_t hash_probes_count = 0;
+    uint64_t rehashes_count = 0;
+    // Память арен, в которых хранятся ключи.
+    uint64_t arena_size = 0;
+    StageTime stage_times[telemetry_stages_count];
+
+    /*!
+    * Возвращает true, если телеметрия собирается в этой сборке.
+    */
+    static bool IsEnabled()
+    {
+#if defined(URL_STATISTICS_TELEMETRY)
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    StageTime& GetStageTime(
+            const TelemetryStage stage)
+    {
+        return stage_times[static_cast<size_t>(stage)];
+    }
+
+    const StageTime& GetStageTime(
+            const TelemetryStage stage) const
+    {
+        return stage_times[static_cast<size_t>(stage)];
+    }
+
+    /*!
+    * Добавляет счетчики и время этапов другой телеметрии.
+    */
+    void Add(
+            const Telemetry& other);
+
+    /*!
+    * Записывает телеметрию в текстовом виде, по строке на группу счетчиков.
+    */
+    void WriteText(
+            std::ostream& output) const;
+
+    /*!
+    * Записывает телеметрию одной строкой JSON.
+    */
+    void WriteJson(
+            std::ostream& output) const;
+};
+
+/*!
+* Возвращает процессорное время текущего потока в наносекундах или 0, если
+* платформа его не сообщает.
+*/
+uint64_t GetThreadCpuTime();
+
+/*!
+* Измеряет время от создания до уничтожения объекта и добавляет его к
+* этапу телеметрии. Без URL_STATISTICS_TELEMETRY ничего не делает.
+*/
+class ScopedStageTimer
+{
+public:
+#if defined(URL_STATISTICS_TELEMETRY)
+    ScopedStageTimer(
+            Telemetry& telemetry,
+            const TelemetryStage stage)
+        : stage_time_(telemetry.GetStageTime(stage))
+        , wall_begin_(std::chrono::steady_clock::now())
+        , cpu_begin_(GetThreadCpuTime())
+    {
+    }
+
+    ~ScopedStageTimer()
+    {
+        stage_time_.wall_nanoseconds += static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now() - wall_begin_).count());
+        stage_time_.cpu_nanoseconds += GetThreadCpuTime() - cpu_begin_;
+        ++stage_time_.calls_count;
+    }
+
+private:
+    StageTime& stage_time_;
+    std::chrono::steady_clock::time_point wall_begin_;
+    uint64_t cpu_begin_;
+#else
+    ScopedStageTimer(
+            Telemetry&,
+            const TelemetryStage)
+    {
+    }
+#endif
+
+    ScopedStageTimer(const ScopedStageTimer&) = delete;
+    ScopedStageTimer& operator=(const ScopedStageTimer&) = delete;
+};
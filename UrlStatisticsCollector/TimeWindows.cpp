@@ -0,0 +1,43 @@
+﻿#include "TimeWindows.h"
+
+#include <cstdio>
+
+std::string FormatTimestamp(
+        const int64_t timestamp)
+{
+    const int64_t seconds_per_day = 24 * 60 * 60;
+    int64_t days = timestamp / seconds_per_day;
+    int64_t seconds_of_day = timestamp % seconds_per_day;
+    if (seconds_of_day < 0)
+    {
+        seconds_of_day += seconds_per_day;
+        --days;
+    }
+
+    // Обратное преобразование civil_from_days.
+    days += 719468;
+    const int64_t era = (days >= 0 ? days : days - 146096) / 146097;
+    const unsigned day_of_era = static_cast<unsigned>(days - era * 146097);
+    const unsigned year_of_era =
+            (day_of_era - day_of_era / 1460 + day_of_era / 36524 - day_of_era / 146096) / 365;
+    const unsigned day_of_year =
+            day_of_era - (365 * year_of_era + year_of_era / 4 - year_of_era / 100);
+    const unsigned shifted_month = (5 * day_of_year + 2) / 153;
+    const unsigned day = day_of_year - (153 * shifted_month + 2) / 5 + 1;
+    const unsigned month = shifted_month < 10 ? shifted_month + 3 : shifted_month - 9;
+    const int64_t year = static_cast<int64_t>(year_of_era) + era * 400 + (month <= 2 ? 1 : 0);
+
+    // Год занимает до 20 символов, остальные поля - до 15.
+    char buffer[48];
+    std::snprintf(
+            buffer,
+            sizeof(buffer),
+            "%04lld-%02u-%02uT%02u:%02u:%02u",
+            static_cast<long long>(year),
+            month,
+            day,
+            static_cast<unsigned>(seconds_of_day / 3600),
+            static_cast<unsigned>(seconds_of_day / 60 % 60),
+            static_cast<unsigned>(seconds_of_day % 60));
+    return buffer;
+}
@@ -0,0 +1,432 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include <cstring>
+#include <cstdint>
+#include <stdexcept>
+
+#include "StringView.h"
+#include "UrlStatistics.h"
+
+/*!
+* Возвращает количество дней от 1970-01-01 до указанной даты григорианского
+* календаря (алгоритм days_from_civil Говарда Хиннанта).
+*/
+inline int64_t DaysFromCivil(
+        int64_t year,
+        const unsigned month,
+        const unsigned day)
+{
+    year -= month <= 2 ? 1 : 0;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const unsigned year_of_era = static_cast<unsigned>(year - era * 400);
+    const unsigned day_of_year = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+    const unsigned day_of_era = year_of_era * 365 + year_of_era / 4 - year_of_era / 100 + day_of_year;
+    return era * 146097 + static_cast<int64_t>(day_of_era) - 719468;
+}
+
+/*!
+* Записывает время в формате "YYYY-MM-DDTHH:MM:SS" (UTC).
+*
+\param[in] timestamp Количество секунд от 1970-01-01T00:00:00.
+*/
+std::string FormatTimestamp(
+        const int64_t timestamp);
+
+/*!
+* Читает десятичное число из digits_count цифр.
+*
+\return false если встретилась не цифра.
+*/
+inline bool ParseFixedDigits(
+        const char* data,
+        const size_t digits_count,
+        unsigned& value)
+{
+    value = 0;
+    for (size_t i = 0; i < digits_count; ++i)
+    {
+        const unsigned digit = static_cast<unsigned char>(data[i]) - '0';
+        if (digit > 9)
+        {
+            return false;
+        }
+
+        value = value * 10 + digit;
+    }
+
+    return true;
+}
+
+inline bool MakeTimestamp(
+        const unsigned year,
+        const unsigned month,
+        const unsigned day,
+        const unsigned hour,
+        const unsigned minute,
+        const unsigned second,
+        int64_t& timestamp)
+{
+    if (month < 1 || month > 12 || day < 1 || day > 31 ||
+            hour > 23 || minute > 59 || second > 60)
+    {
+        return false;
+    }
+
+    timestamp =
+            DaysFromCivil(year, month, day) * 86400 +
+            hour * 3600 + minute * 60 + second;
+    return true;
+}
+
+/*!
+* Разбирает время в формате ISO 8601 "YYYY-MM-DDTHH:MM:SS" (доли секунды
+* и часовой пояс не учитываются, время считается UTC).
+*
+\param[in] data Начало времени, доступно не менее 19 символов.
+*/
+inline bool ParseIsoTimestamp(
+        const char* data,
+        int64_t& timestamp)
+{
+    unsigned year, month, day, hour, minute, second;
+    return data[4] == '-' && data[7] == '-' &&
+            (data[10] == 'T' || data[10] == ' ') &&
+            data[13] == ':' && data[16] == ':' &&
+            ParseFixedDigits(data, 4, year) &&
+            ParseFixedDigits(data + 5, 2, month) &&
+            ParseFixedDigits(data + 8, 2, day) &&
+            ParseFixedDigits(data + 11, 2, hour) &&
+            ParseFixedDigits(data + 14, 2, minute) &&
+            ParseFixedDigits(data + 17, 2, second) &&
+            MakeTimestamp(year, month, day, hour, minute, second, timestamp);
+}
+
+/*!
+* Разбирает время в формате Common Log Format "DD/Mon/YYYY:HH:MM:SS +ZZZZ"
+* и приводит его к UTC.
+*
+\param[in] data Начало времени (после '['), доступно не менее 26 символов.
+*/
+inline bool ParseCommonLogTimestamp(
+        const char* data,
+        int64_t& timestamp)
+{
+    static const char month_names[] = "JanFebMarAprMayJunJulAugSepOctNovDec";
+
+    unsigned month = 0;
+    for (unsigned i = 0; i < 12; ++i)
+    {
+        if (std::memcmp(data + 3, month_names + i * 3, 3) == 0)
+        {
+            month = i + 1;
+            break;
+        }
+    }
+
+    unsigned year, day, hour, minute, second, zone_hours, zone_minutes;
+    if (month == 0 ||
+            data[2] != '/' || data[6] != '/' || data[11] != ':' ||
+            data[14] != ':' || data[17] != ':' || data[20] != ' ' ||
+            (data[21] != '+' && data[21] != '-') ||
+            !ParseFixedDigits(data, 2, day) ||
+            !ParseFixedDigits(data + 7, 4, year) ||
+            !ParseFixedDigits(data + 12, 2, hour) ||
+            !ParseFixedDigits(data + 15, 2, minute) ||
+            !ParseFixedDigits(data + 18, 2, second) ||
+            !ParseFixedDigits(data + 22, 2, zone_hours) ||
+            !ParseFixedDigits(data + 24, 2, zone_minutes) ||
+            !MakeTimestamp(year, month, day, hour, minute, second, timestamp))
+    {
+        return false;
+    }
+
+    const int64_t zone_offset = zone_hours * 3600 + zone_minutes * 60;
+    timestamp += data[21] == '-' ? zone_offset : -zone_offset;
+    return true;
+}
+
+/*!
+* Ищет в начале строки время в формате ISO 8601 или Common Log Format.
+* Просматриваются только первые timestamp_search_limit символов, поэтому
+* поиск не зависит от длины строки.
+*
+\param[in] line Строка лога.
+\param[out] timestamp Время в секундах от 1970-01-01T00:00:00 UTC.
+*
+\return false если время не найдено.
+*/
+inline bool FindLineTimestamp(
+        const StringView line,
+        int64_t& timestamp)
+{
+    const size_t timestamp_search_limit = 256;
+    const char* const begin = line.Data();
+    const char* const end = begin + std::min(line.Size(), timestamp_search_limit);
+
+    // ISO: ищем первый '-' даты, год стоит перед ним.
+    const size_t iso_timestamp_size = 19;
+    for (const char* dash = begin + 4; dash < end; ++dash)
+    {
+        dash = static_cast<const char*>(std::memchr(dash, '-', end - dash));
+        if (dash == nullptr || dash - 4 + iso_timestamp_size > line.Data() + line.Size())
+        {
+            break;
+        }
+
+        if (ParseIsoTimestamp(dash - 4, timestamp))
+        {
+            return true;
+        }
+    }
+
+    const size_t common_log_timestamp_size = 26;
+    for (const char* bracket = begin; bracket < end; ++bracket)
+    {
+        bracket = static_cast<const char*>(std::memchr(bracket, '[', end - bracket));
+        if (bracket == nullptr ||
+                bracket + 1 + common_log_timestamp_size > line.Data() + line.Size())
+        {
+            break;
+        }
+
+        if (ParseCommonLogTimestamp(bracket + 1, timestamp))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+* Статистика по интервалам времени (корзинам) одинаковой длительности.
+* Хранится кольцо из последних windows_count корзин; корзина, выпавшая из
+* кольца, закрывается: передается обработчику и освобождается. Поэтому
+* память ограничена количеством ключей в windows_count корзинах.
+*
+* Строки могут немного нарушать порядок времени: URL-ы попадают в свои
+* корзины, пока те остаются в кольце. Более старые URL-ы отбрасываются и
+* подсчитываются отдельно.
+*/
+class TimeWindowedStatistics
+{
+public:
+    /*!
+    * Обработчик закрываемой корзины.
+    *
+    \param[in] bucket_begin Время начала корзины.
+    \param[in] statistics Статистика корзины.
+    */
+    using BucketHandler = std::function<void(int64_t bucket_begin, const UrlStatistics& statistics)>;
+
+    /*!
+    * Конструктор.
+    *
+    \param[in] bucket_duration Длительность корзины в секундах (60 - минута, 3600 - час).
+    \param[in] windows_count Количество корзин в кольце (ширина скользящего окна).
+    \param[in] close_bucket Обработчик закрываемых корзин.
+    */
+    TimeWindowedStatistics(
+            const int64_t bucket_duration,
+            const size_t windows_count,
+            BucketHandler close_bucket)
+        : bucket_duration_(bucket_duration)
+        , buckets_(windows_count)
+        , close_bucket_(std::move(close_bucket))
+        , has_urls_(false)
+        , newest_bucket_number_(0)
+        , late_urls_count_(0)
+    {
+        if (bucket_duration <= 0 || windows_count == 0)
+        {
+            throw std::invalid_argument(
+                    "TimeWindowedStatistics : Bucket duration and windows count must be positive!");
+        }
+    }
+
+    /*!
+    * Учитывает URL, найденный в строке с указанным временем.
+    */
+    void AddUrl(
+            const int64_t timestamp,
+            const StringView domain,
+            const StringView path)
+    {
+        const int64_t bucket_number = GetBucketNumber(timestamp);
+        const int64_t windows_count = static_cast<int64_t>(buckets_.size());
+        if (!has_urls_)
+        {
+            newest_bucket_number_ = bucket_number;
+            has_urls_ = true;
+        }
+        else if (bucket_number > newest_bucket_number_)
+        {
+            CloseBuckets(bucket_number - windows_count);
+            newest_bucket_number_ = bucket_number;
+        }
+        else if (bucket_number <= newest_bucket_number_ - windows_count)
+        {
+            ++late_urls_count_;
+            return;
+        }
+
+        Bucket& bucket = buckets_[GetSlotIndex(bucket_number)];
+        if (!bucket.is_used)
+        {
+            bucket.is_used = true;
+            bucket.number = bucket_number;
+        }
+
+        bucket.statistics.AddUrl(domain, path);
+    }
+
+    /*!
+    * Вызывает handle_bucket для каждой незакрытой корзины в порядке времени.
+    */
+    void ForEachOpenBucket(
+            const BucketHandler& handle_bucket) const
+    {
+        for (const Bucket* bucket : GetOpenBuckets(newest_bucket_number_))
+        {
+            handle_bucket(bucket->number * bucket_duration_, bucket->statistics);
+        }
+    }
+
+    /*!
+    * Возвращает статистику скользящего окна - всех незакрытых корзин.
+    */
+    UrlStatistics GetWindowStatistics() const
+    {
+        UrlStatistics window_statistics;
+        for (const Bucket& bucket : buckets_)
+        {
+            if (!bucket.is_used)
+            {
+                continue;
+            }
+
+            window_statistics.urls_count += bucket.statistics.urls_count;
+            for (const auto& entry : bucket.statistics.domains)
+            {
+                window_statistics.domains.Increment(entry.key, entry.count);
+            }
+
+            for (const auto& entry : bucket.statistics.paths)
+            {
+                window_statistics.paths.Increment(entry.key, entry.count);
+            }
+        }
+
+        return window_statistics;
+    }
+
+    /*!
+    * Возвращает время начала скользящего окна.
+    */
+    int64_t GetWindowBegin() const
+    {
+        return (newest_bucket_number_ - static_cast<int64_t>(buckets_.size()) + 1) * bucket_duration_;
+    }
+
+    /*!
+    * Возвращает время конца скользящего окна (не включая его).
+    */
+    int64_t GetWindowEnd() const
+    {
+        return (newest_bucket_number_ + 1) * bucket_duration_;
+    }
+
+    /*!
+    * Возвращает true, если добавлен хотя бы один URL.
+    */
+    bool HasUrls() const
+    {
+        return has_urls_;
+    }
+
+    /*!
+    * Возвращает количество URL-ов, отброшенных из-за того, что их корзина
+    * уже была закрыта.
+    */
+    size_t GetLateUrlsCount() const
+    {
+        return late_urls_count_;
+    }
+
+private:
+    struct Bucket
+    {
+        bool is_used = false;
+        int64_t number = 0;
+        UrlStatistics statistics;
+    };
+
+    int64_t GetBucketNumber(
+            const int64_t timestamp) const
+    {
+        // Деление с округлением вниз, чтобы время до 1970 года тоже попадало в свою корзину.
+        const int64_t quotient = timestamp / bucket_duration_;
+        return timestamp % bucket_duration_ < 0 ? quotient - 1 : quotient;
+    }
+
+    size_t GetSlotIndex(
+            const int64_t bucket_number) const
+    {
+        const int64_t windows_count = static_cast<int64_t>(buckets_.size());
+        const int64_t slot_index = bucket_number % windows_count;
+        return static_cast<size_t>(slot_index < 0 ? slot_index + windows_count : slot_index);
+    }
+
+    /*!
+    * Возвращает незакрытые корзины с номерами не больше last_bucket_number
+    * в порядке времени.
+    */
+    std::vector<const Bucket*> GetOpenBuckets(
+            const int64_t last_bucket_number) const
+    {
+        std::vector<const Bucket*> open_buckets;
+        for (const Bucket& bucket : buckets_)
+        {
+            if (bucket.is_used && bucket.number <= last_bucket_number)
+            {
+                open_buckets.push_back(&bucket);
+            }
+        }
+
+        std::sort(
+                open_buckets.begin(),
+                open_buckets.end(),
+                [](const Bucket* left, const Bucket* right)
+                {
+                    return left->number < right->number;
+                });
+        return open_buckets;
+    }
+
+    void CloseBuckets(
+            const int64_t last_bucket_number)
+    {
+        for (const Bucket* open_bucket : GetOpenBuckets(last_bucket_number))
+        {
+            Bucket& bucket = buckets_[GetSlotIndex(open_bucket->number)];
+            if (close_bucket_)
+            {
+                close_bucket_(bucket.number * bucket_duration_, bucket.statistics);
+            }
+
+            bucket = Bucket();
+        }
+    }
+
+private:
+    int64_t bucket_duration_;
+    std::vector<Bucket> buckets_;
+    BucketHandler close_bucket_;
+    bool has_urls_;
+    int64_t newest_bucket_number_;
+    size_t late_urls_count_;
+};
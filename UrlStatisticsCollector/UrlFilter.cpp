@@ -0,0 +1,452 @@
+﻿#include "UrlFilter.h"
+
+#include <fstream>
+#include <stdexcept>
+
+#include "UrlScanner.h"
+
+namespace
+{
+
+std::string ToLowerCase(
+        const std::string& text)
+{
+    std::string result(text.size(), '\0');
+    FoldLatinCase(StringView(text), &result[0]);
+    return result;
+}
+
+uint32_t HashEdge(
+        const size_t parent_index,
+        const unsigned char symbol)
+{
+    const uint64_t key = (static_cast<uint64_t>(parent_index) << 8) | symbol;
+    return static_cast<uint32_t>((key * 0x9e3779b97f4a7c15ULL) >> 32);
+}
+
+} // namespace
+
+bool MatchesGlob(
+        const StringView pattern,
+        const StringView text)
+{
+    // Жадное сопоставление с возвратом к последней '*'.
+    size_t pattern_position = 0;
+    size_t text_position = 0;
+    size_t star_position = std::string::npos;
+    size_t star_text_position = 0;
+    while (text_position < text.Size())
+    {
+        if (pattern_position < pattern.Size() &&
+                (pattern[pattern_position] == '?' ||
+                    pattern[pattern_position] == text[text_position]))
+        {
+            ++pattern_position;
+            ++text_position;
+        }
+        else if (pattern_position < pattern.Size() && pattern[pattern_position] == '*')
+        {
+            star_position = pattern_position++;
+            star_text_position = text_position;
+        }
+        else if (star_position != std::string::npos)
+        {
+            pattern_position = star_position + 1;
+            text_position = ++star_text_position;
+        }
+        else
+        {
+            return false;
+        }
+    }
+
+    while (pattern_position < pattern.Size() && pattern[pattern_position] == '*')
+    {
+        ++pattern_position;
+    }
+
+    return pattern_position == pattern.Size();
+}
+
+void DomainMatcher::AddRule(
+        const std::string& rule)
+{
+    const bool is_zone = rule.compare(0, 2, "*.") == 0;
+    const std::string domain = ToLowerCase(is_zone ? rule.substr(2) : rule);
+    if (domain.empty() || domain.find_first_of("*?") != std::string::npos)
+    {
+        throw std::invalid_argument(
+                "DomainMatcher::AddRule : Unsupported domain rule " + rule + "!");
+    }
+
+    (is_zone ? zones_ : exact_domains_).Increment(StringView(domain));
+}
+
+bool DomainMatcher::Matches(
+        const StringView folded_domain) const
+{
+    if (exact_domains_.Find(folded_domain) != exact_domains_.size())
+    {
+        return true;
+    }
+
+    if (zones_.empty())
+    {
+        return false;
+    }
+
+    // Домен и все его суффиксы, начинающиеся с метки.
+    for (size_t position = 0; ; ++position)
+    {
+        if (zones_.Find(folded_domain.Substring(position, folded_domain.Size() - position)) != zones_.size())
+        {
+            return true;
+        }
+
+        const void* const dot = std::memchr(
+                folded_domain.Data() + position, '.', folded_domain.Size() - position);
+        if (dot == nullptr)
+        {
+            return false;
+        }
+
+        position = static_cast<const char*>(dot) - folded_domain.Data();
+    }
+}
+
+PathMatcher::PathMatcher()
+    : nodes_(2, Node{false, false, 0})
+    , slots_(16)
+{
+}
+
+void PathMatcher::AddRule(
+        const std::string& rule)
+{
+    if (rule.empty())
+    {
+        throw std::invalid_argument(
+                "PathMatcher::AddRule : Empty path rule!");
+    }
+
+    const std::string::size_type wildcard_position = rule.find_first_of("*?");
+    if (wildcard_position != std::string::npos)
+    {
+        const std::string::size_type suffix_position = rule.find_last_of("*?") + 1;
+        if (rule.size() - suffix_position > wildcard_position)
+        {
+            size_t node_index = SuffixRootIndex;
+            for (size_t i = rule.size(); i > suffix_position; --i)
+            {
+                node_index = FindOrAddChild(node_index, static_cast<unsigned char>(rule[i - 1]));
+            }
+
+            Node& node = nodes_[node_index];
+            if (suffix_position == 1 && rule[0] == '*')
+            {
+                node.is_prefix_end = true;
+            }
+            else
+            {
+                globs_.push_back(Glob{rule.substr(0, suffix_position), node.glob_number});
+                node.glob_number = static_cast<uint32_t>(globs_.size());
+            }
+
+            return;
+        }
+    }
+
+    const std::string::size_type literal_size =
+            wildcard_position == std::string::npos ? rule.size() : wildcard_position;
+
+    size_t node_index = PrefixRootIndex;
+    for (size_t i = 0; i < literal_size; ++i)
+    {
+        node_index = FindOrAddChild(node_index, static_cast<unsigned char>(rule[i]));
+    }
+
+    Node& node = nodes_[node_index];
+    if (wildcard_position == std::string::npos)
+    {
+        node.is_exact_end = true;
+    }
+    else if (wildcard_position + 1 == rule.size() && rule.back() == '*')
+    {
+        node.is_prefix_end = true;
+    }
+    else
+    {
+        globs_.push_back(Glob{rule.substr(wildcard_position), node.glob_number});
+        node.glob_number = static_cast<uint32_t>(globs_.size());
+    }
+}
+
+bool PathMatcher::Matches(
+        const StringView path) const
+{
+    return MatchesPrefixes(path) || MatchesSuffixes(path);
+}
+
+bool PathMatcher::MatchesPrefixes(
+        const StringView path) const
+{
+    size_t node_index = PrefixRootIndex;
+    for (size_t position = 0; ; ++position)
+    {
+        const Node& node = nodes_[node_index];
+        if (node.is_prefix_end ||
+                (node.glob_number != 0 &&
+                    MatchesNodeGlobs(node, path.Substring(position, path.Size() - position))))
+        {
+            return true;
+        }
+
+        if (position == path.Size())
+        {
+            return node.is_exact_end;
+        }
+
+        node_index = FindChild(node_index, static_cast<unsigned char>(path[position]));
+        if (node_index == nodes_.size())
+        {
+            return false;
+        }
+    }
+}
+
+bool PathMatcher::MatchesSuffixes(
+        const StringView path) const
+{
+    // Корень дерева конечных частей не хранит правил: у шаблона в этом
+    // дереве конечная часть не пуста.
+    size_t node_index = SuffixRootIndex;
+    for (size_t size = path.Size(); size != 0; --size)
+    {
+        node_index = FindChild(node_index, static_cast<unsigned char>(path[size - 1]));
+        if (node_index == nodes_.size())
+        {
+            return false;
+        }
+
+        const Node& node = nodes_[node_index];
+        if (node.is_prefix_end ||
+                (node.glob_number != 0 &&
+                    MatchesNodeGlobs(node, path.Substring(0, size - 1))))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool PathMatcher::MatchesNodeGlobs(
+        const Node& node,
+        const StringView rest_of_path) const
+{
+    for (uint32_t glob_number = node.glob_number; glob_number != 0; )
+    {
+        const Glob& glob = globs_[glob_number - 1];
+        if (MatchesGlob(StringView(glob.pattern), rest_of_path))
+        {
+            return true;
+        }
+
+        glob_number = glob.next_glob_number;
+    }
+
+    return false;
+}
+
+size_t PathMatcher::FindChild(
+        const size_t parent_index,
+        const unsigned char symbol) const
+{
+    const size_t mask = slots_.size() - 1;
+    for (size_t slot_index = HashEdge(parent_index, symbol) & mask; ; slot_index = (slot_index + 1) & mask)
+    {
+        const Slot& slot = slots_[slot_index];
+        if (slot.parent_number == 0)
+        {
+            return nodes_.size();
+        }
+
+        if (slot.parent_number == parent_index + 1 && slot.symbol == symbol)
+        {
+            return slot.child_index;
+        }
+    }
+}
+
+size_t PathMatcher::FindOrAddChild(
+        const size_t parent_index,
+        const unsigned char symbol)
+{
+    const size_t child_index = FindChild(parent_index, symbol);
+    if (child_index != nodes_.size())
+    {
+        return child_index;
+    }
+
+    nodes_.push_back(Node{false, false, 0});
+    const size_t mask = slots_.size() - 1;
+    size_t slot_index = HashEdge(parent_index, symbol) & mask;
+    while (slots_[slot_index].parent_number != 0)
+    {
+        slot_index = (slot_index + 1) & mask;
+    }
+
+    Slot& slot = slots_[slot_index];
+    slot.parent_number = static_cast<uint32_t>(parent_index + 1);
+    slot.child_index = static_cast<uint32_t>(child_index);
+    slot.symbol = symbol;
+    if (nodes_.size() * 10 > slots_.size() * 7)
+    {
+        Rehash(slots_.size() * 2);
+    }
+
+    return child_index;
+}
+
+void PathMatcher::Rehash(
+        const size_t slots_count)
+{
+    std::vector<Slot> slots(slots_count);
+    const size_t mask = slots_count - 1;
+    for (const Slot& slot : slots_)
+    {
+        if (slot.parent_number == 0)
+        {
+            continue;
+        }
+
+        size_t slot_index = HashEdge(slot.parent_number - 1, slot.symbol) & mask;
+        while (slots[slot_index].parent_number != 0)
+        {
+            slot_index = (slot_index + 1) & mask;
+        }
+
+        slots[slot_index] = slot;
+    }
+
+    slots_.swap(slots);
+}
+
+void UrlFilter::AllowDomain(
+        const std::string& rule)
+{
+    allowed_domains_.AddRule(rule);
+}
+
+void UrlFilter::DenyDomain(
+        const std::string& rule)
+{
+    denied_domains_.AddRule(rule);
+}
+
+void UrlFilter::AllowPath(
+        const std::string& rule)
+{
+    allowed_paths_.AddRule(rule);
+}
+
+void UrlFilter::DenyPath(
+        const std::string& rule)
+{
+    denied_paths_.AddRule(rule);
+}
+
+void UrlFilter::AddRule(
+        const std::string& line)
+{
+    const std::string::size_type separator_position = line.find(' ');
+    const std::string kind = line.substr(0, separator_position);
+    const std::string::size_type rule_position = line.find_first_not_of(' ', separator_position);
+    const std::string rule = rule_position == std::string::npos
+            ? std::string()
+            : line.substr(rule_position);
+
+    if (kind == "allow-domain")
+    {
+        AllowDomain(rule);
+    }
+    else if (kind == "deny-domain")
+    {
+        DenyDomain(rule);
+    }
+    else if (kind == "allow-path")
+    {
+        AllowPath(rule);
+    }
+    else if (kind == "deny-path")
+    {
+        DenyPath(rule);
+    }
+    else
+    {
+        throw std::invalid_argument(
+                "UrlFilter::AddRule : Unknown rule " + line + "!");
+    }
+}
+
+void UrlFilter::LoadRules(
+        const std::string& file_path)
+{
+    std::ifstream rules_file(file_path);
+    if (!rules_file.is_open())
+    {
+        throw std::invalid_argument(
+                "UrlFilter::LoadRules : Can not open rules file " + file_path + "!");
+    }
+
+    std::string line;
+    while (std::getline(rules_file, line))
+    {
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.pop_back();
+        }
+
+        if (!line.empty() && line[0] != '#')
+        {
+            AddRule(line);
+        }
+    }
+}
+
+bool UrlFilter::Empty() const
+{
+    return allowed_domains_.Empty() &&
+            denied_domains_.Empty() &&
+            allowed_paths_.Empty() &&
+            denied_paths_.Empty();
+}
+
+bool UrlFilter::IsAccepted(
+        const StringView domain,
+        const StringView path) const
+{
+    if (!allowed_domains_.Empty() || !denied_domains_.Empty())
+    {
+        // Домены почти всегда короче буфера; более длинные приводятся в строке.
+        char folded_domain_buffer[256];
+        std::string long_folded_domain;
+        char* folded_domain_data = folded_domain_buffer;
+        if (domain.Size() > sizeof(folded_domain_buffer))
+        {
+            long_folded_domain.resize(domain.Size());
+            folded_domain_data = &long_folded_domain[0];
+        }
+
+        FoldLatinCase(domain, folded_domain_data);
+        const StringView folded_domain(folded_domain_data, domain.Size());
+        if ((!allowed_domains_.Empty() && !allowed_domains_.Matches(folded_domain)) ||
+                (!denied_domains_.Empty() && denied_domains_.Matches(folded_domain)))
+        {
+            return false;
+        }
+    }
+
+    return (allowed_paths_.Empty() || allowed_paths_.Matches(path)) &&
+            (denied_paths_.Empty() || !denied_paths_.Matches(path));
+}
@@ -0,0 +1,183 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <cstdint>
+
+#include "StringView.h"
+#include "Counters.h"
+
+/*!
+* Набор правил для доменов. Правило "example.org" совпадает только с этим
+* доменом, "*.example.org" - с example.org и всеми его поддоменами. Регистр
+* не учитывается. Правила хранятся в хеш-таблицах, поэтому проверка домена
+* стоит не больше одного поиска на метку независимо от количества правил.
+*/
+class DomainMatcher
+{
+public:
+    /*!
+    * Добавляет правило.
+    */
+    void AddRule(
+            const std::string& rule);
+
+    bool Empty() const
+    {
+        return exact_domains_.empty() && zones_.empty();
+    }
+
+    /*!
+    * Проверяет домен.
+    *
+    \param[in] folded_domain Домен в нижнем регистре.
+    */
+    bool Matches(
+            const StringView folded_domain) const;
+
+private:
+    StringCounterTable exact_domains_;
+    StringCounterTable zones_;
+};
+
+/*!
+* Набор правил для путей: точный путь ("/favicon.ico"), префикс (путь с '*'
+* в конце) или шаблон с '*' (любая последовательность) и '?' (любой символ).
+* Правила собраны в префиксное дерево по символам: путь проходится один раз,
+* а у шаблона дерево хранит часть до первого символа шаблона, так что
+* полностью сверяются только шаблоны, чья начальная часть совпала. Шаблоны,
+* у которых часть после последнего символа шаблона длиннее начальной
+* (например, "*.php"), хранятся во втором дереве по перевернутой конечной
+* части, которое проходится с конца пути. Поэтому проверка зависит от длины
+* пути и числа шаблонов с общей литеральной частью, а не от числа правил.
+*/
+class PathMatcher
+{
+public:
+    PathMatcher();
+
+    /*!
+    * Добавляет правило.
+    */
+    void AddRule(
+            const std::string& rule);
+
+    bool Empty() const
+    {
+        return nodes_.size() == 2;
+    }
+
+    bool Matches(
+            const StringView path) const;
+
+private:
+    // Корни дерева начальных частей и дерева перевернутых конечных частей.
+    static const size_t PrefixRootIndex = 0;
+    static const size_t SuffixRootIndex = 1;
+
+    struct Node
+    {
+        bool is_exact_end;
+        // В дереве конечных частей - совпадает любой путь с этим окончанием.
+        bool is_prefix_end;
+        // Номер первого шаблона узла, увеличенный на единицу. 0 - шаблонов нет.
+        uint32_t glob_number;
+    };
+
+    struct Glob
+    {
+        // Шаблон без части, хранящейся в дереве.
+        std::string pattern;
+        uint32_t next_glob_number;
+    };
+
+    struct Slot
+    {
+        // Номер родителя, увеличенный на единицу. 0 - ячейка свободна.
+        uint32_t parent_number = 0;
+        uint32_t child_index = 0;
+        unsigned char symbol = 0;
+    };
+
+    size_t FindChild(
+            const size_t parent_index,
+            const unsigned char symbol) const;
+
+    size_t FindOrAddChild(
+            const size_t parent_index,
+            const unsigned char symbol);
+
+    void Rehash(
+            const size_t slots_count);
+
+    bool MatchesPrefixes(
+            const StringView path) const;
+
+    bool MatchesSuffixes(
+            const StringView path) const;
+
+    bool MatchesNodeGlobs(
+            const Node& node,
+            const StringView rest_of_path) const;
+
+private:
+    std::vector<Node> nodes_;
+    std::vector<Glob> globs_;
+    // Ребра дерева по паре (родитель, символ), общие для всех узлов.
+    std::vector<Slot> slots_;
+};
+
+/*!
+* Фильтр URL-ов. Учитываются только URL-ы, домен и путь которых проходят
+* правила: при непустом списке разрешенных значение должно совпасть с одним
+* из них, и ни с одним из запрещенных. Проверка выполняется при разборе до
+* обновления счетчиков.
+*/
+class UrlFilter
+{
+public:
+    void AllowDomain(
+            const std::string& rule);
+
+    void DenyDomain(
+            const std::string& rule);
+
+    void AllowPath(
+            const std::string& rule);
+
+    void DenyPath(
+            const std::string& rule);
+
+    /*!
+    * Добавляет правило вида "allow-domain RULE", "deny-domain RULE",
+    * "allow-path RULE" или "deny-path RULE".
+    */
+    void AddRule(
+            const std::string& line);
+
+    /*!
+    * Загружает правила из файла, по одному на строку. Пустые строки и строки,
+    * начинающиеся с '#', пропускаются.
+    */
+    void LoadRules(
+            const std::string& file_path);
+
+    bool Empty() const;
+
+    bool IsAccepted(
+            const StringView domain,
+            const StringView path) const;
+
+private:
+    DomainMatcher allowed_domains_;
+    DomainMatcher denied_domains_;
+    PathMatcher allowed_paths_;
+    PathMatcher denied_paths_;
+};
+
+/*!
+* Проверяет строку на соответствие шаблону с '*' и '?'.
+*/
+bool MatchesGlob(
+        const StringView pattern,
+        const StringView text);
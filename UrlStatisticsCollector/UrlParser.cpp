@@ -0,0 +1,31 @@
+﻿#include "UrlParser.h"
+
+#include <algorithm>
+
+std::vector<StringView> SplitBlockByLines(
+        const StringView block,
+        const size_t parts_count)
+{
+    std::vector<StringView> parts;
+    const char* part_begin = block.Data();
+    const char* const end = block.Data() + block.Size();
+
+    for (size_t i = 1; i <= parts_count && part_begin != end; ++i)
+    {
+        const char* part_end = i == parts_count
+                ? end
+                : std::max(block.Data() + block.Size() / parts_count * i, part_begin);
+
+        if (part_end != end)
+        {
+            const char* line_end = static_cast<const char*>(
+                    std::memchr(part_end, '\n', end - part_end));
+            part_end = line_end == nullptr ? end : line_end + 1;
+        }
+
+        parts.push_back(StringView(part_begin, part_end - part_begin));
+        part_begin = part_end;
+    }
+
+    return parts;
+}
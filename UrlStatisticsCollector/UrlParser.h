@@ -0,0 +1,316 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "StringView.h"
+#include "Telemetry.h"
+#include "UrlScanner.h"
+#include "UrlStatistics.h"
+#include "TimeWindows.h"
+
+/*!
+* Разбирает входные данные и накапливает найденные URL-ы в статистике.
+*/
+class UrlParser
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] statistics Статистика, в которую будут добавляться найденные URL-ы.
+    \param[in] time_windows Статистика по интервалам времени. Если задана,
+    * в каждой строке ищется время, и URL-ы строк со временем добавляются
+    * также в нее.
+    */
+    explicit UrlParser(
+            UrlStatistics& statistics,
+            TimeWindowedStatistics* time_windows = nullptr)
+        : statistics_(statistics)
+        , time_windows_(time_windows)
+        , is_line_timestamp_found_(false)
+        , line_timestamp_(0)
+    {
+    }
+
+    /*!
+    * Обрабатывает блок входных данных. Префиксы URL-ов ищутся сразу по всему
+    * блоку, и только строки, в которых они найдены, разбираются отдельно.
+    * Строки без URL-ов пропускаются целыми участками, без поиска их границ.
+    * Строки не копируются, обработка идет прямо по данным блока.
+    */
+    void ProcessBlock(
+            const StringView block)
+    {
+        const ScopedStageTimer parse_timer(statistics_.telemetry, TelemetryStage::Parse);
+        URL_STATISTICS_TELEMETRY_ADD(statistics_.telemetry.bytes_count, block.Size());
+        URL_STATISTICS_TELEMETRY_ADD(statistics_.telemetry.lines_count, CountLines(block));
+        const char* const begin = block.Data();
+        const char* const end = block.Data() + block.Size();
+        std::string::size_type position = 0;
+
+        while (position < block.Size())
+        {
+            const std::string::size_type url_position =
+                    url_prefix_scanner_.Search(block, position);
+            if (url_position == std::string::npos)
+            {
+                break;
+            }
+
+            // Префикс не содержит '\n', поэтому целиком лежит в одной строке.
+            // Разбор URL-ов идет только вперед, так что начало строки нужно
+            // лишь для поиска времени, иначе строкой считается весь участок
+            // от конца предыдущей разобранной строки.
+            const char* line_begin = begin + position;
+            if (time_windows_ != nullptr)
+            {
+                line_begin = begin + url_position;
+                while (line_begin != begin + position && line_begin[-1] != '\n')
+                {
+                    --line_begin;
+                }
+            }
+
+            const char* line_end = static_cast<const char*>(
+                    std::memchr(begin + url_position, '\n', end - (begin + url_position)));
+            if (line_end == nullptr)
+            {
+                line_end = end;
+            }
+
+            ProcessLine(
+                    StringView(line_begin, line_end - line_begin),
+                    begin + url_position - line_begin);
+            position = line_end == end ? block.Size() : line_end + 1 - begin;
+        }
+    }
+
+private:
+    std::string::size_type GetPositionAfterPrefix(
+            const StringView line,
+            std::string::size_type position) const
+    {
+        // Префикс уже проверен сканером, осталось определить его длину.
+        return line[position + 4] == ':' ? position + 7 : position + 8;
+    }
+
+    template <SymbolClass symbol_class>
+    std::string::size_type GetPositionAfterCertainUrlPart(
+            const StringView line,
+            const std::string::size_type position) const
+    {
+        return FindSymbolClassSpanEnd<symbol_class>(line, position);
+    }
+
+    std::string::size_type ParseUrl(
+            const StringView line,
+            std::string::size_type position)
+    {
+        const std::string::size_type after_prefix_position =
+                GetPositionAfterPrefix(line, position);
+
+        const std::string::size_type after_domain_position =
+                GetPositionAfterCertainUrlPart<DomainSymbol>(
+                    line,
+                    after_prefix_position);
+
+        if (after_domain_position == after_prefix_position)
+        {
+            return position + 4;
+        }
+
+        StringView domain =
+                line.Substring(
+                    after_prefix_position,
+                    after_domain_position - after_prefix_position);
+
+        if (statistics_.is_domain_case_folded)
+        {
+            domain = FoldDomainCase(domain);
+        }
+
+        // При нормализации путь включает экранированные символы ("%2F").
+        const std::string::size_type after_path_position =
+                statistics_.path_normalization == PathNormalization::Disabled
+                    ? GetPositionAfterCertainUrlPart<PathSymbol>(
+                        line,
+                        after_domain_position)
+                    : GetPositionAfterCertainUrlPart<EscapedPathSymbol>(
+                        line,
+                        after_domain_position);
+
+        StringView path =
+                line.Substring(
+                    after_domain_position,
+                    after_path_position - after_domain_position);
+
+        // Поиск следующего URL-а продолжается с той же позиции, что и без
+        // нормализации (с первого '%'), чтобы количество URL-ов не зависело
+        // от режима.
+        std::string::size_type search_position = after_path_position;
+        if (statistics_.path_normalization != PathNormalization::Disabled)
+        {
+            const void* const percent_sign = std::memchr(path.Data(), '%', path.Size());
+            if (percent_sign != nullptr)
+            {
+                search_position = static_cast<const char*>(percent_sign) - line.Data();
+            }
+
+            path = NormalizePath(path, statistics_.path_normalization, normalized_path_);
+        }
+
+        if (path.Empty())
+        {
+            path = StringView("/", 1);
+        }
+
+        // Отфильтрованный URL обходится только проверкой правил.
+        if (statistics_.url_filter != nullptr &&
+                !statistics_.url_filter->IsAccepted(domain, path))
+        {
+            return search_position;
+        }
+
+        // Обязательные части(префикс и домен) существуют, поэтому учитываем URL.
+        statistics_.AddUrl(domain, path);
+        if (is_line_timestamp_found_)
+        {
+            time_windows_->AddUrl(line_timestamp_, domain, path);
+        }
+
+        if (statistics_.is_query_parsed &&
+                after_path_position < line.Size() &&
+                line[after_path_position] == '?')
+        {
+            // Запрос делится на параметры в том же проходе, что ищет его конец:
+            // ключ идет до '=' или '&', значение - до '&'. Фрагмент ('#') в
+            // классы символов запроса не входит. Пустые параметры пропускаются.
+            std::string::size_type parameter_begin = after_path_position + 1;
+            for (;;)
+            {
+                const std::string::size_type key_end =
+                        GetPositionAfterCertainUrlPart<QueryKeySymbol>(
+                            line,
+                            parameter_begin);
+                const std::string::size_type parameter_end =
+                        key_end < line.Size() && line[key_end] == '='
+                            ? GetPositionAfterCertainUrlPart<QueryValueSymbol>(
+                                line,
+                                key_end + 1)
+                            : key_end;
+
+                if (parameter_end != parameter_begin)
+                {
+                    statistics_.AddQueryParameter(
+                            line.Substring(
+                                parameter_begin,
+                                parameter_end - parameter_begin),
+                            key_end - parameter_begin);
+                }
+
+                if (parameter_end == line.Size() || line[parameter_end] != '&')
+                {
+                    break;
+                }
+
+                parameter_begin = parameter_end + 1;
+            }
+        }
+
+        // Поиск продолжается сразу после пути и при разборе запросов, чтобы
+        // URL-ы внутри запроса ("?url=http://...") учитывались так же, как
+        // без него.
+        return search_position;
+    }
+
+    /*!
+    * Приводит домен к нижнему регистру в буфере разбора. Входные данные не
+    * изменяются (они могут быть отображены только для чтения), а буфер растет
+    * лишь до длины самого длинного домена.
+    */
+    StringView FoldDomainCase(
+            const StringView domain)
+    {
+        if (folded_domain_.size() < domain.Size())
+        {
+            folded_domain_.resize(domain.Size());
+        }
+
+        FoldLatinCase(domain, folded_domain_.data());
+        return StringView(folded_domain_.data(), domain.Size());
+    }
+
+    /*!
+    * Возвращает количество строк в блоке, включая последнюю строку без
+    * перевода строки.
+    */
+    static uint64_t CountLines(
+            const StringView block)
+    {
+        if (block.Size() == 0)
+        {
+            return 0;
+        }
+
+        return CountSymbol(block, '\n') + (block[block.Size() - 1] == '\n' ? 0 : 1);
+    }
+
+    /*!
+    * Разбирает URL-ы строки.
+    *
+    \param[in] input_file_line Строка входных данных.
+    \param[in] first_url_position Позиция первого префикса URL-а в строке.
+    */
+    void ProcessLine(
+            const StringView input_file_line,
+            const std::string::size_type first_url_position)
+    {
+        std::string::size_type current_position = first_url_position;
+        is_line_timestamp_found_ =
+                time_windows_ != nullptr &&
+                FindLineTimestamp(input_file_line, line_timestamp_);
+
+        while (current_position != std::string::npos &&
+                current_position < input_file_line.Size())
+        {
+            // Ищем первое вхождение префикса URL-а.
+            current_position =
+                    url_prefix_scanner_.Search(
+                        input_file_line,
+                        current_position);
+
+            if (current_position == std::string::npos)
+            {
+                break;
+            }
+
+            URL_STATISTICS_TELEMETRY_ADD(statistics_.telemetry.url_candidates_count, 1);
+
+            current_position =
+                    ParseUrl(input_file_line, current_position);
+        }
+    }
+
+private:
+    UrlStatistics& statistics_;
+    TimeWindowedStatistics* time_windows_;
+    bool is_line_timestamp_found_;
+    int64_t line_timestamp_;
+    UrlPrefixScanner url_prefix_scanner_;
+    std::vector<char> folded_domain_;
+    std::vector<char> normalized_path_;
+};
+
+/*!
+* Делит блок на части примерно одинакового размера по границам строк.
+*
+\param[in] block Блок входных данных.
+\param[in] parts_count Желаемое количество частей.
+*
+\return Части блока. Их может оказаться меньше parts_count, если строк мало.
+*/
+std::vector<StringView> SplitBlockByLines(
+        const StringView block,
+        const size_t parts_count);
@@ -0,0 +1,33 @@
+﻿#include "UrlScanner.h"
+
+InstructionSet DetectInstructionSet()
+{
+#if defined(URL_STATISTICS_X86_64)
+#if defined(_MSC_VER)
+    int registers[4];
+    __cpuid(registers, 0);
+    if (registers[0] >= 7)
+    {
+        __cpuidex(registers, 7, 0);
+        const bool has_avx2 = (registers[1] & (1 << 5)) != 0;
+        __cpuid(registers, 1);
+        const bool has_os_avx_support =
+                (registers[2] & (1 << 27)) != 0 &&
+                (_xgetbv(0) & 6) == 6;
+        if (has_avx2 && has_os_avx_support)
+        {
+            return InstructionSet::Avx2;
+        }
+    }
+#else
+    if (__builtin_cpu_supports("avx2"))
+    {
+        return InstructionSet::Avx2;
+    }
+#endif
+    // SSE2 входит в базовый набор x86-64.
+    return InstructionSet::Sse2;
+#else
+    return InstructionSet::Scalar;
+#endif
+}
@@ -0,0 +1,797 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdint>
+
+#include "StringView.h"
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define URL_STATISTICS_X86_64
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(_MSC_VER)
+#define URL_STATISTICS_TARGET_AVX2
+#else
+#define URL_STATISTICS_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/*!
+* Класс для поиска подстрок в строке. Реализация алгоритма Кнута — Морриса — Пратта.
+*/
+class SubstringSearcher
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] pattern Строка, которая будет искаться.
+    */
+    SubstringSearcher(
+            const std::string& pattern)
+        : pattern_(pattern)
+        , prefix_function_result_(pattern.size())
+    {
+        Preprocessing();
+    }
+
+    /*!
+    * Ищет заранее определенную подстроку в строке line.
+    *
+    \param[in] line Строка, в которой будет производиться поиск.
+    \param[in] begin_position Позиция в строке line, начиная с которой
+    * будет производиться поиск.
+    *
+    \return Позиция в строке, следующая за последним символом искомой
+    * подстроки, std::strin::npos иначе.
+    */
+    std::string::size_type Search(
+            const StringView line,
+            const std::string::size_type begin_position)
+    {
+        for (std::string::size_type k = 0, i = begin_position
+            ; i < line.Size()
+            ; ++i)
+        {
+            while ((k > 0) && (pattern_[k] != line[i]))
+            {
+                k = prefix_function_result_[k - 1];
+            }
+
+            if (pattern_[k] == line[i])
+            {
+                ++k;
+            }
+
+            if (k == pattern_.size())
+            {
+                return (i - pattern_.size() + 1);
+            }
+        }
+
+        return std::string::npos;
+    }
+private:
+    void Preprocessing()
+    {
+        prefix_function_result_.resize(
+                pattern_.size());
+        prefix_function_result_.front() = 0;
+
+        for (std::string::size_type k = 0, i = 1
+            ; i < pattern_.size()
+            ; ++i)
+        {
+            while ((k > 0) && (pattern_[i] != pattern_[k]))
+            {
+                k = prefix_function_result_[k - 1];
+            }
+
+            if (pattern_[i] == pattern_[k])
+            {
+                k++;
+            }
+
+            prefix_function_result_[i] = k;
+        }
+    }
+
+private:
+    std::string pattern_;
+    std::vector<int> prefix_function_result_;
+};
+
+/*!
+* Набор инструкций, используемый векторизованными алгоритмами.
+*/
+enum class InstructionSet
+{
+    Scalar,
+    Sse2,
+    Avx2,
+    // Лучший из поддерживаемых процессором.
+    Auto
+};
+
+/*!
+* Определяет лучший набор инструкций, поддерживаемый процессором.
+*/
+InstructionSet DetectInstructionSet();
+
+/*!
+* Возвращает номер младшего установленного бита. mask не должна быть нулевой.
+*/
+inline unsigned CountTrailingZeros(
+        const unsigned mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+}
+
+/*!
+* Классы символов URL-а. Символ может принадлежать нескольким классам сразу.
+*/
+enum SymbolClass : unsigned char
+{
+    // Латиница, цифры, точка и дефис.
+    DomainSymbol = 1 << 0,
+    // Латиница, цифры и символы ". , / + _".
+    PathSymbol = 1 << 1,
+    // Символы строки запроса (RFC 3986): печатные символы ASCII, кроме
+    // пробела, '#' (начало фрагмента) и символов " < > [ \ ] ^ ` { | }.
+    QuerySymbol = 1 << 2,
+    // Символы пути и '%' (пути с экранированными символами при нормализации).
+    EscapedPathSymbol = 1 << 3,
+    // Символы ключа и значения параметра запроса: символы запроса без '&'
+    // (разделитель параметров), а у ключа - еще и без '='.
+    QueryKeySymbol = 1 << 4,
+    QueryValueSymbol = 1 << 5
+};
+
+/*!
+* Таблица классов для всех 256 значений байта.
+*/
+struct SymbolClassTable
+{
+    unsigned char classes[256];
+};
+
+constexpr bool IsLetterOrNumber(
+        const int symbol)
+{
+    return (symbol >= 'a' && symbol <= 'z') ||
+            (symbol >= 'A' && symbol <= 'Z') ||
+            (symbol >= '0' && symbol <= '9');
+}
+
+constexpr SymbolClassTable MakeSymbolClassTable()
+{
+    SymbolClassTable table = {};
+    for (int symbol = 0; symbol < 256; ++symbol)
+    {
+        unsigned char symbol_classes = 0;
+        if (IsLetterOrNumber(symbol) || symbol == '.' || symbol == '-')
+        {
+            symbol_classes |= DomainSymbol;
+        }
+
+        if (IsLetterOrNumber(symbol) ||
+                symbol == '.' ||
+                symbol == ',' ||
+                symbol == '/' ||
+                symbol == '+' ||
+                symbol == '_')
+        {
+            symbol_classes |= PathSymbol | EscapedPathSymbol;
+        }
+
+        if (symbol == '%')
+        {
+            symbol_classes |= EscapedPathSymbol;
+        }
+
+        if (symbol > ' ' && symbol < 0x7F &&
+                symbol != '"' && symbol != '#' &&
+                symbol != '<' && symbol != '>' &&
+                (symbol < '[' || symbol > '^') &&
+                symbol != '`' &&
+                (symbol < '{' || symbol > '}'))
+        {
+            symbol_classes |= QuerySymbol;
+            if (symbol != '&')
+            {
+                symbol_classes |= QueryValueSymbol;
+                if (symbol != '=')
+                {
+                    symbol_classes |= QueryKeySymbol;
+                }
+            }
+        }
+
+        table.classes[symbol] = symbol_classes;
+    }
+
+    return table;
+}
+
+constexpr SymbolClassTable symbol_class_table = MakeSymbolClassTable();
+
+/*!
+* Проверяет символ на принадлежность к классу symbol_class.
+*/
+template <SymbolClass symbol_class>
+inline bool IsSymbolOfClass(
+        const char symbol)
+{
+    return (symbol_class_table.classes[static_cast<unsigned char>(symbol)] & symbol_class) != 0;
+}
+
+#if defined(URL_STATISTICS_X86_64)
+/*!
+* Возвращает маску байтов, попадающих в диапазон [low, high]. Байты больше
+* 0x7F сравниваются как отрицательные и в диапазон не попадают.
+*/
+inline __m128i MatchRange(
+        const __m128i symbols,
+        const char low,
+        const char high)
+{
+    return _mm_and_si128(
+            _mm_cmpgt_epi8(symbols, _mm_set1_epi8(low - 1)),
+            _mm_cmplt_epi8(symbols, _mm_set1_epi8(high + 1)));
+}
+
+/*!
+* Возвращает маску байтов, принадлежащих классу symbol_class. Повторяет
+* содержимое symbol_class_table.
+*/
+template <SymbolClass symbol_class>
+inline __m128i MatchSymbolClass(
+        const __m128i symbols)
+{
+    if (symbol_class == QuerySymbol ||
+            symbol_class == QueryKeySymbol ||
+            symbol_class == QueryValueSymbol)
+    {
+        const __m128i excluded = _mm_or_si128(
+                _mm_or_si128(
+                    MatchRange(symbols, '"', '#'),
+                    MatchRange(symbols, '[', '^')),
+                _mm_or_si128(
+                    _mm_or_si128(
+                        _mm_cmpeq_epi8(symbols, _mm_set1_epi8('<')),
+                        _mm_cmpeq_epi8(symbols, _mm_set1_epi8('>'))),
+                    _mm_or_si128(
+                        _mm_cmpeq_epi8(symbols, _mm_set1_epi8('`')),
+                        MatchRange(symbols, '{', '}'))));
+        __m128i query_symbols = _mm_andnot_si128(excluded, MatchRange(symbols, '!', '~'));
+        if (symbol_class != QuerySymbol)
+        {
+            query_symbols = _mm_andnot_si128(
+                    _mm_cmpeq_epi8(symbols, _mm_set1_epi8('&')),
+                    query_symbols);
+        }
+
+        if (symbol_class == QueryKeySymbol)
+        {
+            query_symbols = _mm_andnot_si128(
+                    _mm_cmpeq_epi8(symbols, _mm_set1_epi8('=')),
+                    query_symbols);
+        }
+
+        return query_symbols;
+    }
+
+    // После установки бита 0x20 заглавные буквы совпадают со строчными.
+    const __m128i letters_and_numbers = _mm_or_si128(
+            MatchRange(_mm_or_si128(symbols, _mm_set1_epi8(0x20)), 'a', 'z'),
+            MatchRange(symbols, '0', '9'));
+
+    if (symbol_class == DomainSymbol)
+    {
+        return _mm_or_si128(
+                letters_and_numbers,
+                MatchRange(symbols, '-', '.'));
+    }
+
+    // "+ , - . /" идут подряд, дефис из них исключаем.
+    const __m128i path_symbols = _mm_or_si128(
+            _mm_or_si128(
+                letters_and_numbers,
+                _mm_cmpeq_epi8(symbols, _mm_set1_epi8('_'))),
+            _mm_andnot_si128(
+                _mm_cmpeq_epi8(symbols, _mm_set1_epi8('-')),
+                MatchRange(symbols, '+', '/')));
+
+    if (symbol_class == EscapedPathSymbol)
+    {
+        return _mm_or_si128(
+                path_symbols,
+                _mm_cmpeq_epi8(symbols, _mm_set1_epi8('%')));
+    }
+
+    return path_symbols;
+}
+#endif
+
+/*!
+* Ищет конец непрерывной последовательности символов класса symbol_class.
+*
+\param[in] line Строка, в которой производится поиск.
+\param[in] position Позиция начала последовательности.
+*
+\return Позиция первого символа не из класса symbol_class либо размер строки.
+*/
+template <SymbolClass symbol_class>
+inline size_t FindSymbolClassSpanEnd(
+        const StringView line,
+        size_t position)
+{
+#if defined(URL_STATISTICS_X86_64)
+    for (; position + 16 <= line.Size(); position += 16)
+    {
+        const __m128i symbols = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(line.Data() + position));
+        const unsigned mismatch_mask =
+                ~static_cast<unsigned>(_mm_movemask_epi8(MatchSymbolClass<symbol_class>(symbols))) & 0xFFFF;
+        if (mismatch_mask != 0)
+        {
+            return position + CountTrailingZeros(mismatch_mask);
+        }
+    }
+#endif
+
+    while (position < line.Size() &&
+            IsSymbolOfClass<symbol_class>(line[position]))
+    {
+        ++position;
+    }
+
+    return position;
+}
+
+/*!
+* Считает вхождения символа в строку. Обрабатывается по 16 байтов за шаг
+* (SSE2): совпадения копятся в байтовых счетчиках, которые суммируются
+* каждые 255 шагов, остаток - посимвольно.
+*/
+inline size_t CountSymbol(
+        const StringView line,
+        const char symbol)
+{
+    size_t count = 0;
+    size_t position = 0;
+#if defined(URL_STATISTICS_X86_64)
+    const __m128i pattern = _mm_set1_epi8(symbol);
+    while (position + 16 <= line.Size())
+    {
+        __m128i byte_counts = _mm_setzero_si128();
+        for (size_t steps = 0; steps < 255 && position + 16 <= line.Size(); ++steps, position += 16)
+        {
+            const __m128i symbols = _mm_loadu_si128(
+                    reinterpret_cast<const __m128i*>(line.Data() + position));
+            // Совпадение дает -1, вычитание прибавляет единицу.
+            byte_counts = _mm_sub_epi8(byte_counts, _mm_cmpeq_epi8(symbols, pattern));
+        }
+
+        const __m128i sums = _mm_sad_epu8(byte_counts, _mm_setzero_si128());
+        count += static_cast<size_t>(_mm_cvtsi128_si32(sums)) +
+                static_cast<size_t>(_mm_extract_epi16(sums, 4));
+    }
+#endif
+
+    for (; position < line.Size(); ++position)
+    {
+        count += line[position] == symbol;
+    }
+
+    return count;
+}
+
+/*!
+* Копирует строку, приводя латиницу к нижнему регистру. Обрабатывается по
+* 16 байтов за шаг (SSE2), остаток - посимвольно.
+*
+\param[in] source Исходная строка.
+\param[out] destination Буфер размером не меньше source.Size().
+*/
+inline void FoldLatinCase(
+        const StringView source,
+        char* destination)
+{
+    size_t position = 0;
+#if defined(URL_STATISTICS_X86_64)
+    for (; position + 16 <= source.Size(); position += 16)
+    {
+        const __m128i symbols = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(source.Data() + position));
+        const __m128i upper_case_bits = _mm_and_si128(
+                MatchRange(symbols, 'A', 'Z'),
+                _mm_set1_epi8(0x20));
+        _mm_storeu_si128(
+                reinterpret_cast<__m128i*>(destination + position),
+                _mm_or_si128(symbols, upper_case_bits));
+    }
+#endif
+
+    for (; position < source.Size(); ++position)
+    {
+        destination[position] = static_cast<char>(ToLowerCaseSymbol(source[position]));
+    }
+}
+
+/*!
+* Режим нормализации путей.
+*/
+enum class PathNormalization
+{
+    // Пути учитываются как есть.
+    Disabled,
+    // Декодируются %XX, удаляются сегменты "." и ".." и повторные '/'.
+    Enabled,
+    // То же, и удаляется завершающий '/' (кроме пути "/").
+    EnabledWithoutTrailingSlash
+};
+
+/*!
+* Возвращает true, если путь может измениться при нормализации: в нем есть
+* '%', '/' перед '/' или '.', либо завершающий '/', который нужно удалить.
+* Пути без таких мест (обычный случай) проверяются по 16 байтов за шаг (SSE2).
+*/
+inline bool IsPathNormalizationNeeded(
+        const StringView path,
+        const bool is_trailing_slash_stripped)
+{
+    if (is_trailing_slash_stripped && path.Size() > 1 && path[path.Size() - 1] == '/')
+    {
+        return true;
+    }
+
+    size_t position = 0;
+#if defined(URL_STATISTICS_X86_64)
+    // Второй вектор сдвинут на байт: в нем символы, следующие за символами первого.
+    for (; position + 17 <= path.Size(); position += 16)
+    {
+        const __m128i symbols = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(path.Data() + position));
+        const __m128i next_symbols = _mm_loadu_si128(
+                reinterpret_cast<const __m128i*>(path.Data() + position + 1));
+        const __m128i candidates = _mm_or_si128(
+                _mm_cmpeq_epi8(symbols, _mm_set1_epi8('%')),
+                _mm_and_si128(
+                    _mm_cmpeq_epi8(symbols, _mm_set1_epi8('/')),
+                    MatchRange(next_symbols, '.', '/')));
+        if (_mm_movemask_epi8(candidates) != 0)
+        {
+            return true;
+        }
+    }
+#endif
+
+    for (; position < path.Size(); ++position)
+    {
+        if (path[position] == '%' ||
+                (path[position] == '/' &&
+                    position + 1 < path.Size() &&
+                    (path[position + 1] == '.' || path[position + 1] == '/')))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+/*!
+* Возвращает значение шестнадцатеричной цифры или -1.
+*/
+inline int GetHexDigitValue(
+        const char symbol)
+{
+    if (symbol >= '0' && symbol <= '9')
+    {
+        return symbol - '0';
+    }
+
+    const unsigned char lower_case_symbol = ToLowerCaseSymbol(symbol);
+    return lower_case_symbol >= 'a' && lower_case_symbol <= 'f'
+            ? lower_case_symbol - 'a' + 10
+            : -1;
+}
+
+/*!
+* Нормализует путь: декодирует %XX, если получается символ пути (остальные
+* экранирования приводятся к виду с заглавными цифрами), затем удаляет
+* сегменты "." и ".." (RFC 3986, 5.2.4) и повторные '/'. Путь без таких мест
+* возвращается как есть, без копирования.
+*
+\param[in] path Путь.
+\param[in] path_normalization Режим нормализации, не Disabled.
+\param[in,out] buffer Буфер результата. Растет лишь до длины самого длинного
+* пути, поэтому при разборе память на каждый путь не выделяется.
+*
+\return Нормализованный путь, ссылающийся на path или buffer.
+*/
+inline StringView NormalizePath(
+        const StringView path,
+        const PathNormalization path_normalization,
+        std::vector<char>& buffer)
+{
+    const bool is_trailing_slash_stripped =
+            path_normalization == PathNormalization::EnabledWithoutTrailingSlash;
+    if (!IsPathNormalizationNeeded(path, is_trailing_slash_stripped))
+    {
+        return path;
+    }
+
+    // Для завершающего '/' после последнего сегмента нужен еще один байт.
+    if (buffer.size() < path.Size() + 1)
+    {
+        buffer.resize(path.Size() + 1);
+    }
+
+    // Декодирование. Результат не длиннее исходного пути.
+    char* const data = buffer.data();
+    size_t size = 0;
+    for (size_t position = 0; position < path.Size(); ++position)
+    {
+        const int high_digit = path[position] == '%' && position + 2 < path.Size()
+                ? GetHexDigitValue(path[position + 1])
+                : -1;
+        const int low_digit = high_digit < 0 ? -1 : GetHexDigitValue(path[position + 2]);
+        if (low_digit < 0)
+        {
+            data[size++] = path[position];
+            continue;
+        }
+
+        const char symbol = static_cast<char>(high_digit * 16 + low_digit);
+        if (IsSymbolOfClass<PathSymbol>(symbol))
+        {
+            data[size++] = symbol;
+        }
+        else
+        {
+            const char* const hex_digits = "0123456789ABCDEF";
+            data[size++] = '%';
+            data[size++] = hex_digits[high_digit];
+            data[size++] = hex_digits[low_digit];
+        }
+
+        position += 2;
+    }
+
+    // Сегменты переписываются на месте: запись никогда не обгоняет чтение,
+    // кроме '/' после последнего сегмента, для которого есть запасной байт.
+    // Каждый оставленный сегмент записывается вместе с последующим '/'.
+    const size_t root_size = size != 0 && data[0] == '/' ? 1 : 0;
+    size_t written_size = root_size;
+    bool is_directory = false;
+    for (size_t segment_begin = root_size; segment_begin <= size; )
+    {
+        size_t segment_end = segment_begin;
+        while (segment_end < size && data[segment_end] != '/')
+        {
+            ++segment_end;
+        }
+
+        const size_t segment_size = segment_end - segment_begin;
+        const bool is_dot = segment_size == 1 && data[segment_begin] == '.';
+        const bool is_double_dot =
+                segment_size == 2 && data[segment_begin] == '.' && data[segment_begin + 1] == '.';
+        is_directory = segment_size == 0 || is_dot || is_double_dot;
+        if (is_double_dot && written_size > root_size)
+        {
+            --written_size;
+            while (written_size > root_size && data[written_size - 1] != '/')
+            {
+                --written_size;
+            }
+        }
+        else if (!is_directory)
+        {
+            std::memmove(data + written_size, data + segment_begin, segment_size);
+            written_size += segment_size;
+            data[written_size++] = '/';
+        }
+
+        segment_begin = segment_end + 1;
+    }
+
+    if (written_size > root_size && (!is_directory || is_trailing_slash_stripped))
+    {
+        --written_size;
+    }
+
+    return StringView(data, written_size);
+}
+
+/*!
+* Класс для поиска префиксов URL-ов ("http://" и "https://") в строке.
+* Кандидаты ищутся по 16 (SSE2) или 32 (AVX2) байта за шаг: одновременно
+* проверяются первый и четвертый символы префикса, а полная проверка
+* выполняется только для найденных кандидатов.
+*/
+class UrlPrefixScanner
+{
+public:
+    /*!
+    * Конструктор.
+    *
+    \param[in] instruction_set Используемый набор инструкций. Если процессор
+    * его не поддерживает, используется лучший из доступных.
+    */
+    explicit UrlPrefixScanner(
+            InstructionSet instruction_set = InstructionSet::Auto)
+    {
+        const InstructionSet supported_instruction_set = DetectInstructionSet();
+        if (instruction_set == InstructionSet::Auto ||
+                instruction_set > supported_instruction_set)
+        {
+            instruction_set = supported_instruction_set;
+        }
+
+        switch (instruction_set)
+        {
+#if defined(URL_STATISTICS_X86_64)
+        case InstructionSet::Avx2:
+            search_function_ = &SearchAvx2;
+            break;
+        case InstructionSet::Sse2:
+            search_function_ = &SearchSse2;
+            break;
+#endif
+        default:
+            search_function_ = &SearchScalar;
+            break;
+        }
+    }
+
+    /*!
+    * Ищет префикс URL-а в строке line.
+    *
+    \param[in] line Строка, в которой будет производиться поиск.
+    \param[in] begin_position Позиция в строке line, начиная с которой
+    * будет производиться поиск.
+    *
+    \return Позиция начала префикса, std::string::npos если префикс не найден.
+    */
+    std::string::size_type Search(
+            const StringView line,
+            const std::string::size_type begin_position) const
+    {
+        return search_function_(line, begin_position);
+    }
+
+    /*!
+    * Проверяет, начинается ли с позиции position префикс URL-а.
+    */
+    static bool IsUrlPrefix(
+            const StringView line,
+            const std::string::size_type position)
+    {
+        const size_t rest_size = line.Size() - position;
+        const char* prefix = line.Data() + position;
+        if (rest_size < 7 || std::memcmp(prefix, "http", 4) != 0)
+        {
+            return false;
+        }
+
+        return std::memcmp(prefix + 4, "://", 3) == 0 ||
+                (rest_size >= 8 && std::memcmp(prefix + 4, "s://", 4) == 0);
+    }
+
+private:
+    using SearchFunction = std::string::size_type (*)(
+            const StringView line,
+            const std::string::size_type begin_position);
+
+    static std::string::size_type SearchScalar(
+            const StringView line,
+            std::string::size_type position)
+    {
+        while (position < line.Size())
+        {
+            const char* candidate = static_cast<const char*>(
+                    std::memchr(line.Data() + position, 'h', line.Size() - position));
+            if (candidate == nullptr)
+            {
+                break;
+            }
+
+            position = candidate - line.Data();
+            if (IsUrlPrefix(line, position))
+            {
+                return position;
+            }
+
+            ++position;
+        }
+
+        return std::string::npos;
+    }
+
+#if defined(URL_STATISTICS_X86_64)
+    static std::string::size_type SearchSse2(
+            const StringView line,
+            std::string::size_type position)
+    {
+        const __m128i first_symbol = _mm_set1_epi8('h');
+        const __m128i fourth_symbol = _mm_set1_epi8('p');
+
+        // Читаем 16 байт с позиций position и position + 3, поэтому должно
+        // оставаться не меньше 19 байт.
+        for (; position + 19 <= line.Size(); position += 16)
+        {
+            const char* block = line.Data() + position;
+            const __m128i first = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block));
+            const __m128i fourth = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + 3));
+            const __m128i candidates = _mm_and_si128(
+                    _mm_cmpeq_epi8(first, first_symbol),
+                    _mm_cmpeq_epi8(fourth, fourth_symbol));
+
+            unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(candidates));
+            while (mask != 0)
+            {
+                const std::string::size_type candidate_position =
+                        position + CountTrailingZeros(mask);
+                if (IsUrlPrefix(line, candidate_position))
+                {
+                    return candidate_position;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+
+        return SearchScalar(line, position);
+    }
+
+    URL_STATISTICS_TARGET_AVX2
+    static std::string::size_type SearchAvx2(
+            const StringView line,
+            std::string::size_type position)
+    {
+        const __m256i first_symbol = _mm256_set1_epi8('h');
+        const __m256i fourth_symbol = _mm256_set1_epi8('p');
+
+        for (; position + 35 <= line.Size(); position += 32)
+        {
+            const char* block = line.Data() + position;
+            const __m256i first = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block));
+            const __m256i fourth = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + 3));
+            const __m256i candidates = _mm256_and_si256(
+                    _mm256_cmpeq_epi8(first, first_symbol),
+                    _mm256_cmpeq_epi8(fourth, fourth_symbol));
+
+            unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(candidates));
+            while (mask != 0)
+            {
+                const std::string::size_type candidate_position =
+                        position + CountTrailingZeros(mask);
+                if (IsUrlPrefix(line, candidate_position))
+                {
+                    return candidate_position;
+                }
+
+                mask &= mask - 1;
+            }
+        }
+
+        return SearchSse2(line, position);
+    }
+#endif
+
+private:
+    SearchFunction search_function_;
+};
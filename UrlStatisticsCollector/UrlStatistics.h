@@ -0,0 +1,372 @@
+﻿#pragma once
+
+#include <memory>
+
+#include "Counters.h"
+#include "UrlScanner.h"
+#include "Snapshot.h"
+#include "Telemetry.h"
+#include "PathPrefixTree.h"
+#include "UrlFilter.h"
+
+/*!
+* Статистика, собранная по части входных данных.
+*/
+struct UrlStatistics
+{
+    size_t urls_count = 0;
+    // Домены приводятся к нижнему регистру при разборе.
+    bool is_domain_case_folded = false;
+    StringToCountMap domains;
+    // Пути нормализуются при разборе, если задан режим нормализации.
+    PathNormalization path_normalization = PathNormalization::Disabled;
+    StringToCountMap paths;
+    // Приближенные счетчики. Используются вместо точных таблиц, если
+    // задана их емкость.
+    bool is_approximate = false;
+    SpaceSavingCounter approximate_domains;
+    SpaceSavingCounter approximate_paths;
+    // Оценки количества различных доменов и путей.
+    HyperLogLog domains_cardinality;
+    HyperLogLog paths_cardinality;
+    // Дерево префиксов путей для top-N по каталогам. Заполняется при разборе,
+    // только если включено, независимо от режима подсчета путей.
+    bool is_path_prefix_tree_built = false;
+    PathPrefixTree path_prefixes;
+    // Ключи параметров строк запроса и пары "ключ=значение". Считаются
+    // точно и только если включен разбор запросов.
+    bool is_query_parsed = false;
+    StringToCountMap query_keys;
+    StringToCountMap query_parameters;
+    // Совместные счетчики пар (домен, путь) для top путей каждого домена.
+    // Ведутся только в точном режиме: ключами служат номера записей таблиц.
+    bool are_domain_paths_counted = false;
+    DomainPathCounterTable domain_paths;
+    // Фильтр URL-ов, общий для статистик всех потоков. nullptr - учитывать все.
+    std::shared_ptr<const UrlFilter> url_filter;
+    // Телеметрия разбора: байты, строки, кандидаты и время этапов потока,
+    // который заполнял эту статистику.
+    Telemetry telemetry;
+
+    /*!
+    * Конструктор.
+    *
+    \param[in] approximate_top_capacity Емкость приближенных счетчиков.
+    * 0 - считать точно.
+    \param[in] cardinality_precision Точность оценки количества различных
+    * доменов и путей. 0 - количество берется из таблиц.
+    \param[in] is_domain_case_folded Считать домены без учета регистра.
+    \param[in] is_path_prefix_tree_built Заполнять дерево префиксов путей.
+    \param[in] is_query_parsed Считать параметры строк запроса.
+    \param[in] path_normalization Режим нормализации путей.
+    \param[in] are_domain_paths_counted Вести совместные счетчики пар
+    * (домен, путь). В приближенном режиме не ведутся.
+    */
+    explicit UrlStatistics(
+            const size_t approximate_top_capacity = 0,
+            const size_t cardinality_precision = 0,
+            const bool is_domain_case_folded = false,
+            const bool is_path_prefix_tree_built = false,
+            const bool is_query_parsed = false,
+            const PathNormalization path_normalization = PathNormalization::Disabled,
+            const bool are_domain_paths_counted = false)
+        : is_domain_case_folded(is_domain_case_folded)
+        , path_normalization(path_normalization)
+        , is_approximate(approximate_top_capacity != 0)
+        , approximate_domains(approximate_top_capacity)
+        , approximate_paths(approximate_top_capacity)
+        , domains_cardinality(cardinality_precision)
+        , paths_cardinality(cardinality_precision)
+        , is_path_prefix_tree_built(is_path_prefix_tree_built)
+        , is_query_parsed(is_query_parsed)
+        , are_domain_paths_counted(are_domain_paths_counted && approximate_top_capacity == 0)
+    {
+    }
+
+    /*!
+    * Учитывает найденный URL.
+    */
+    void AddUrl(
+            const StringView domain,
+            const StringView path)
+    {
+        ++urls_count;
+        if (domains_cardinality.IsEnabled())
+        {
+            domains_cardinality.Add(domain);
+            paths_cardinality.Add(path);
+        }
+
+        if (is_path_prefix_tree_built)
+        {
+            path_prefixes.Add(path);
+        }
+
+        if (is_approximate)
+        {
+            approximate_domains.Increment(domain);
+            approximate_paths.Increment(path);
+            return;
+        }
+
+        // Если нужно, домен уже приведен к нижнему регистру разбором.
+        const size_t domain_index = domains.Increment(domain);
+        const size_t path_index = paths.Increment(path);
+        if (are_domain_paths_counted)
+        {
+            domain_paths.Increment(domain_index, path_index);
+        }
+    }
+
+    /*!
+    * Учитывает параметр строки запроса URL-а. Память выделяется только для
+    * ключей и пар, встреченных впервые.
+    *
+    \param[in] parameter Параметр целиком ("key=value"), не пустой.
+    \param[in] key_size Длина ключа (до первого '='). 0 - ключ пуст и
+    * учитывается только пара.
+    */
+    void AddQueryParameter(
+            const StringView parameter,
+            const size_t key_size)
+    {
+        if (key_size != 0)
+        {
+            query_keys.Increment(parameter.Substring(0, key_size));
+        }
+
+        query_parameters.Increment(parameter);
+    }
+
+    /*!
+    * Добавляет к статистике данные снимка.
+    */
+    void AddSnapshot(
+            const SnapshotReader& snapshot_reader)
+    {
+        urls_count += snapshot_reader.GetUrlsCount();
+        AddSnapshotSection(
+                snapshot_reader.GetDomains(),
+                is_domain_case_folded,
+                PathNormalization::Disabled,
+                domains,
+                approximate_domains,
+                domains_cardinality,
+                nullptr);
+        AddSnapshotSection(
+                snapshot_reader.GetPaths(),
+                false,
+                path_normalization,
+                paths,
+                approximate_paths,
+                paths_cardinality,
+                is_path_prefix_tree_built ? &path_prefixes : nullptr);
+    }
+
+    /*!
+    * Добавляет к статистике данные другой статистики. Результат не зависит
+    * от порядка слияния.
+    *
+    \param[in] other Сливаемая статистика. После слияния ее содержимое не определено.
+    */
+    void Merge(
+            UrlStatistics& other)
+    {
+        urls_count += other.urls_count;
+        telemetry.Add(other.telemetry);
+        if (are_domain_paths_counted)
+        {
+            MergeDomainPaths(other);
+        }
+        else
+        {
+            MergeCounters(domains, other.domains);
+            MergeCounters(paths, other.paths);
+        }
+
+        MergeCounters(query_keys, other.query_keys);
+        MergeCounters(query_parameters, other.query_parameters);
+        approximate_domains.Merge(other.approximate_domains);
+        approximate_paths.Merge(other.approximate_paths);
+        domains_cardinality.Merge(other.domains_cardinality);
+        paths_cardinality.Merge(other.paths_cardinality);
+        path_prefixes.Merge(other.path_prefixes);
+    }
+
+    /*!
+    * Возвращает телеметрию разбора, дополненную счетчиками таблиц.
+    */
+    Telemetry GetTelemetry() const
+    {
+        Telemetry result = telemetry;
+        if (Telemetry::IsEnabled())
+        {
+            result.urls_count = urls_count;
+            result.hash_probes_count += domains.GetProbesCount() + paths.GetProbesCount();
+            result.rehashes_count += domains.GetRehashesCount() + paths.GetRehashesCount();
+            result.arena_size += domains.GetArenaSize() + paths.GetArenaSize();
+        }
+
+        return result;
+    }
+
+    /*!
+    * Возвращает наибольший объем памяти в байтах, занимавшийся таблицами счетчиков.
+    */
+    size_t GetPeakMemoryUsage() const
+    {
+        return domains.GetPeakMemoryUsage() +
+                paths.GetPeakMemoryUsage() +
+                approximate_domains.GetMemoryUsage() +
+                approximate_paths.GetMemoryUsage() +
+                domains_cardinality.GetMemoryUsage() +
+                paths_cardinality.GetMemoryUsage() +
+                path_prefixes.GetMemoryUsage() +
+                query_keys.GetPeakMemoryUsage() +
+                query_parameters.GetPeakMemoryUsage() +
+                domain_paths.GetPeakMemoryUsage();
+    }
+
+private:
+    /*!
+    * Добавляет раздел снимка. Снимок мог быть записан без приведения
+    * регистра и нормализации путей, поэтому ключи приводятся здесь.
+    *
+    \param[in] key_prefixes Дерево префиксов, в которое также добавляются
+    * ключи, или nullptr.
+    */
+    void AddSnapshotSection(
+            SnapshotSectionCursor cursor,
+            const bool is_case_folded,
+            const PathNormalization key_normalization,
+            StringToCountMap& counters,
+            SpaceSavingCounter& approximate_counters,
+            HyperLogLog& cardinality,
+            PathPrefixTree* const key_prefixes)
+    {
+        StringView key;
+        size_t count = 0;
+        std::vector<char> folded_key;
+        std::vector<char> normalized_key;
+        while (cursor.Next(key, count))
+        {
+            if (is_case_folded)
+            {
+                folded_key.resize(std::max(folded_key.size(), key.Size()));
+                FoldLatinCase(key, folded_key.data());
+                key = StringView(folded_key.data(), key.Size());
+            }
+
+            if (key_normalization != PathNormalization::Disabled)
+            {
+                key = NormalizePath(key, key_normalization, normalized_key);
+                if (key.Empty())
+                {
+                    key = StringView("/", 1);
+                }
+            }
+
+            if (key_prefixes != nullptr)
+            {
+                key_prefixes->Add(key, count);
+            }
+
+            // Повторная оценка одного ключа (после нормализации ключи
+            // раздела могут совпасть) результата не меняет.
+            if (cardinality.IsEnabled())
+            {
+                cardinality.Add(key);
+            }
+
+            if (is_approximate)
+            {
+                approximate_counters.Increment(key, count);
+            }
+            else
+            {
+                counters.Increment(key, count);
+            }
+        }
+    }
+
+    /*!
+    * Сливает таблицы, обходя меньшую из них.
+    *
+    \param[out] source_indices Если задан, номера записей обойденной таблицы
+    * в итоговой.
+    *
+    \return true, если таблицы поменялись местами: обойдена прежняя target.
+    */
+    static bool MergeCounters(
+            StringToCountMap& target,
+            StringToCountMap& source,
+            std::vector<uint32_t>* const source_indices = nullptr)
+    {
+        const bool are_swapped = target.size() < source.size();
+        if (are_swapped)
+        {
+            target.swap(source);
+        }
+
+        if (source_indices != nullptr)
+        {
+            source_indices->reserve(source.size());
+        }
+
+        for (const auto& entry : source)
+        {
+            const size_t index = target.Increment(entry.key, entry.count);
+            if (source_indices != nullptr)
+            {
+                source_indices->push_back(static_cast<uint32_t>(index));
+            }
+        }
+
+        target.AddTelemetryCounts(source);
+        source.clear();
+        return are_swapped;
+    }
+
+    /*!
+    * Сливает таблицы доменов и путей вместе с совместными счетчиками. Номера
+    * записей обойденных при слиянии таблиц меняются, поэтому пары той
+    * статистики, чьи таблицы обходились, переводятся на новые номера.
+    */
+    void MergeDomainPaths(
+            UrlStatistics& other)
+    {
+        std::vector<uint32_t> domain_indices;
+        std::vector<uint32_t> path_indices;
+        const bool are_domains_swapped = MergeCounters(domains, other.domains, &domain_indices);
+        const bool are_paths_swapped = MergeCounters(paths, other.paths, &path_indices);
+
+        const auto add_domain_paths = [&](
+                DomainPathCounterTable& target,
+                const DomainPathCounterTable& source,
+                const bool are_domains_renumbered,
+                const bool are_paths_renumbered)
+        {
+            for (const auto& entry : source)
+            {
+                target.Increment(
+                        are_domains_renumbered ? domain_indices[entry.domain_index] : entry.domain_index,
+                        are_paths_renumbered ? path_indices[entry.path_index] : entry.path_index,
+                        entry.count);
+            }
+        };
+
+        if (!are_domains_swapped && !are_paths_swapped)
+        {
+            add_domain_paths(domain_paths, other.domain_paths, true, true);
+        }
+        else
+        {
+            DomainPathCounterTable merged_domain_paths;
+            add_domain_paths(merged_domain_paths, domain_paths, are_domains_swapped, are_paths_swapped);
+            add_domain_paths(merged_domain_paths, other.domain_paths, !are_domains_swapped, !are_paths_swapped);
+            domain_paths.swap(merged_domain_paths);
+        }
+
+        other.domain_paths = DomainPathCounterTable();
+    }
+};
@@ -1,525 +1,1367 @@
-﻿#include <string>
+﻿#include "UrlStatisticsCollector.h"
+
 #include <fstream>
+#include <cstring>
+#include <sstream>
 #include <algorithm>
-#include <vector>
-#include <unordered_map>
-#include <queue>
-#include <memory>
-#include <iostream>
-#include <stack>
-
-/*!
-* Переводит строку в нижний регистр.
-*
-\param[in] data Строка с возможным наличием символов в верхнем регистре.
-*
-\return строка data в нижнем регистре.
-*/
-std::string ToLowerCase(
-        const std::string& data)
-{
-    std::string lower_case_data;
-    lower_case_data.resize(data.size());
-    std::transform(
-            data.begin(),
-            data.end(),
-            lower_case_data.begin(),
-            ::tolower);
-    return lower_case_data;
-}
-
-/*!
-* Класс для проверки символов на предмет их содержания во множестве допустимых значений.
-*/
-class SymbolChecker
-{
-public:
-
-    enum class CorrectSymbolsSetType
-    {
-        Domain,
-        Path
-    };
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+
+namespace
+{
+
+// Читает очередной блок, добавляя время ожидания к этапу чтения.
+bool ReadTimedBlock(
+        InputSource& input_source,
+        StringView& block,
+        Telemetry& telemetry)
+{
+    const ScopedStageTimer read_timer(telemetry, TelemetryStage::Read);
+    return input_source.ReadBlock(block);
+}
+
+} // namespace
+
+UrlStatisticsCollector::UrlStatisticsCollector()
+    : UrlStatisticsCollector(std::string())
+{
+    input_file_paths_.clear();
+}
+
+UrlStatisticsCollector::UrlStatisticsCollector(
+        const std::string& input_file_path)
+    : input_file_paths_(1, input_file_path)
+    , is_file_processed_(false)
+    , threads_count_(1)
+    , file_read_mode_(FileReadMode::Mapped)
+    , is_domain_case_folded_(false)
+    , domain_level_(0)
+    , path_depth_(0)
+    , is_query_parsed_(false)
+    , path_normalization_(PathNormalization::Disabled)
+    , are_domain_paths_counted_(false)
+    , approximate_top_capacity_(0)
+    , cardinality_precision_(0)
+    , peak_memory_usage_(0)
+    , is_statistics_collected_(false)
+    , size_of_top_rate_(5)
+    , time_bucket_duration_(0)
+    , time_windows_count_(0)
+    , time_series_size_of_top_(0)
+    , telemetry_interval_seconds_(0)
+{
+}
 
-    /*!
-    * Конструктор.
-    *
-    \param[in] correct_symbols_set_type Задает набор допустимых значений.
-    */
-    SymbolChecker(
-            const CorrectSymbolsSetType correct_symbols_set_type)
-        : correct_symbols_set_type_(correct_symbols_set_type)
+void UrlStatisticsCollector::SetInputFilePath(
+        const std::string& input_file_path)
+{
+    SetInputFilePaths(std::vector<std::string>(1, input_file_path));
+}
+
+void UrlStatisticsCollector::SetInputFilePaths(
+        const std::vector<std::string>& input_file_paths)
+{
+    if (input_file_paths_ != input_file_paths)
     {
-    };
+        input_file_paths_ = input_file_paths;
+        is_file_processed_ = false;
+    }
+}
 
-    virtual ~SymbolChecker()
+void UrlStatisticsCollector::SetThreadsCount(
+        const size_t threads_count)
+{
+    threads_count_ = threads_count;
+}
+
+void UrlStatisticsCollector::SetDomainLevel(
+        const size_t domain_level)
+{
+    domain_level_ = domain_level;
+}
+
+void UrlStatisticsCollector::SetPathDepth(
+        const size_t path_depth)
+{
+    const bool was_path_prefix_tree_built = IsPathPrefixTreeBuilt();
+    path_depth_ = path_depth;
+    if (IsPathPrefixTreeBuilt() != was_path_prefix_tree_built)
     {
+        is_file_processed_ = false;
     }
+}
 
-    /*!
-    * Проверяет символ на принадлежность к множеству допустимых значений.
-    *
-    \return true если символ принадлежит множеству допустимых значений, false - иначе.
-    */
-    virtual bool CheckSymbol(
-            const char symbol) const = 0;
+void UrlStatisticsCollector::SetPathPrefix(
+        const std::string& path_prefix)
+{
+    const bool was_path_prefix_tree_built = IsPathPrefixTreeBuilt();
+    path_prefix_ = path_prefix;
+    if (IsPathPrefixTreeBuilt() != was_path_prefix_tree_built)
+    {
+        is_file_processed_ = false;
+    }
+}
 
-protected:
-    bool CheckLettersAndNumbers(
-            const char symbol) const
+void UrlStatisticsCollector::SetQueryStatistics(
+        const bool is_query_parsed)
+{
+    if (is_query_parsed_ != is_query_parsed)
     {
-        return (symbol >= 'a' && symbol <= 'z') ||
-                (symbol >= 'A' && symbol <= 'Z') ||
-                (symbol >= '0' && symbol <= '9');
+        is_query_parsed_ = is_query_parsed;
+        is_file_processed_ = false;
     }
+}
 
-protected:
-    CorrectSymbolsSetType correct_symbols_set_type_;
-};
+void UrlStatisticsCollector::SetPathNormalization(
+        const PathNormalization path_normalization)
+{
+    if (path_normalization_ != path_normalization)
+    {
+        path_normalization_ = path_normalization;
+        is_file_processed_ = false;
+    }
+}
 
-class PathSymbolChecker : public SymbolChecker
+void UrlStatisticsCollector::SetDomainPathCounting(
+        const bool are_domain_paths_counted)
 {
-public:
-    explicit PathSymbolChecker(
-            const CorrectSymbolsSetType correct_symbols_set_type)
-        : SymbolChecker(correct_symbols_set_type)
+    if (are_domain_paths_counted_ != are_domain_paths_counted)
     {
+        are_domain_paths_counted_ = are_domain_paths_counted;
+        is_file_processed_ = false;
     }
+}
 
-    bool CheckSymbol(
-        const char symbol) const override
+void UrlStatisticsCollector::SetUrlFilter(
+        UrlFilter url_filter)
+{
+    if (url_filter.Empty())
     {
-        return CheckLettersAndNumbers(symbol) ||
-                symbol == '.' ||
-                symbol == ',' ||
-                symbol == '/' ||
-                symbol == '+' ||
-                symbol == '_';
+        url_filter_.reset();
     }
-};
+    else
+    {
+        url_filter_ = std::make_shared<const UrlFilter>(std::move(url_filter));
+    }
+
+    is_file_processed_ = false;
+}
 
-class DomainSymbolChecker : public SymbolChecker
+void UrlStatisticsCollector::SetFileReadMode(
+        const FileReadMode file_read_mode)
 {
-public:
-    explicit DomainSymbolChecker(
-            const CorrectSymbolsSetType correct_symbols_set_type)
-        : SymbolChecker(correct_symbols_set_type)
+    file_read_mode_ = file_read_mode;
+}
+
+void UrlStatisticsCollector::SetDomainCaseFolding(
+        const bool is_domain_case_folded)
+{
+    if (is_domain_case_folded_ != is_domain_case_folded)
     {
+        is_domain_case_folded_ = is_domain_case_folded;
+        is_file_processed_ = false;
     }
+}
 
-    bool CheckSymbol(
-        const char symbol) const override
+void UrlStatisticsCollector::SetApproximateTopCapacity(
+        const size_t approximate_top_capacity)
+{
+    if (approximate_top_capacity_ != approximate_top_capacity)
     {
-        return CheckLettersAndNumbers(symbol) ||
-                symbol == '.' ||
-                symbol == '-';
+        approximate_top_capacity_ = approximate_top_capacity;
+        is_file_processed_ = false;
     }
-};
+}
 
-/*!
-* Класс для поиска подстрок в строке. Реализация алгоритма Кнута — Морриса — Пратта.
-*/
-class SubstringSearcher
+void UrlStatisticsCollector::SetCardinalityPrecision(
+        const size_t cardinality_precision)
 {
-public:
-    /*!
-    * Конструктор.
-    *
-    \param[in] pattern Строка, которая будет искаться.
-    */
-    SubstringSearcher(
-            const std::string& pattern)
-        : pattern_(pattern)
-        , prefix_function_result_(pattern.size())
+    if (cardinality_precision_ != cardinality_precision)
     {
-        Preprocessing();
+        cardinality_precision_ = cardinality_precision;
+        is_file_processed_ = false;
     }
+}
+
+size_t UrlStatisticsCollector::GetDomainsMaximumError()
+{
+    EnsureStatisticsCollected();
+    return statistics_.approximate_domains.GetMaximumError();
+}
 
-    /*!
-    * Ищет заранее определенную подстроку в строке line.
-    *
-    \param[in] line Строка, в которой будет производиться поиск.
-    \param[in] begin_position Позиция в строке line, начиная с которой
-    * будет производиться поиск.
-    *
-    \return Позиция в строке, следующая за последним символом искомой
-    * подстроки, std::strin::npos иначе.
-    */
-    std::string::size_type Search(
-            const std::string& line,
-            const std::string::size_type begin_position)
+size_t UrlStatisticsCollector::GetPathsMaximumError()
+{
+    EnsureStatisticsCollected();
+    return statistics_.approximate_paths.GetMaximumError();
+}
+
+size_t UrlStatisticsCollector::GetPeakMemoryUsage() const
+{
+    return peak_memory_usage_;
+}
+
+Telemetry UrlStatisticsCollector::GetTelemetry() const
+{
+    Telemetry telemetry = statistics_.GetTelemetry();
+    telemetry.Add(telemetry_);
+    return telemetry;
+}
+
+void UrlStatisticsCollector::SetTelemetryHandler(
+        const std::function<void(const Telemetry&)>& telemetry_handler,
+        const size_t interval_seconds)
+{
+    telemetry_handler_ = telemetry_handler;
+    telemetry_interval_seconds_ = interval_seconds;
+}
+
+void UrlStatisticsCollector::WriteStatistics(
+        const std::string& output_file_path,
+        const size_t size_of_top)
+{
+    EnsureStatisticsCollected();
+
+    if (output_file_path.empty())
     {
-        for (std::string::size_type k = 0, i = begin_position
-            ; i < line.size()
-            ; ++i)
-        {
-            while ((k > 0) && (pattern_[k] != line[i]))
-            {
-                k = prefix_function_result_[k - 1];
-            }
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteStatistics : Output file path is empty!");
+    }
 
-            if (pattern_[k] == line[i])
+    const ScopedStageTimer report_timer(telemetry_, TelemetryStage::Report);
+    WriteOutputFile(
+            output_file_path,
+            "UrlStatisticsCollector::WriteStatistics",
+            [this, size_of_top](std::ostream& output_file)
             {
-                ++k;
-            }
+                WriteReport(
+                        statistics_,
+                        size_of_top,
+                        output_file);
+            });
+}
 
-            if (k == pattern_.size())
-            {
-                return (i - pattern_.size() + 1);
-            }
-        }
+void UrlStatisticsCollector::SetTimeWindows(
+        const size_t bucket_duration_seconds,
+        const size_t windows_count,
+        const size_t size_of_top)
+{
+    if (bucket_duration_seconds != 0 && windows_count == 0)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::SetTimeWindows : Windows count is zero!");
+    }
+
+    time_bucket_duration_ = bucket_duration_seconds;
+    time_windows_count_ = windows_count;
+    time_series_size_of_top_ = size_of_top;
+    is_file_processed_ = false;
+}
 
-        return std::string::npos;
+void UrlStatisticsCollector::WriteTimeSeries(
+        const std::string& output_file_path)
+{
+    if (time_bucket_duration_ == 0)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteTimeSeries : Time windows are not set!");
     }
-private:
-    void Preprocessing()
+
+    EnsureStatisticsCollected();
+
+    if (output_file_path.empty())
     {
-        prefix_function_result_.resize(
-                pattern_.size());
-        prefix_function_result_.front() = 0;
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteTimeSeries : Output file path is empty!");
+    }
 
-        for (std::string::size_type k = 0, i = 1
-            ; i < pattern_.size()
-            ; ++i)
-        {
-            while ((k > 0) && (pattern_[i] != pattern_[k]))
+    WriteOutputFile(
+            output_file_path,
+            "UrlStatisticsCollector::WriteTimeSeries",
+            [this](std::ostream& output_file)
             {
-                k = prefix_function_result_[k - 1];
-            }
+                for (const std::string& bucket_report : closed_bucket_reports_)
+                {
+                    output_file << bucket_report;
+                }
+
+                time_windows_->ForEachOpenBucket(
+                        [this, &output_file](const int64_t bucket_begin, const UrlStatistics& statistics)
+                        {
+                            WriteBucketReport(bucket_begin, statistics, output_file);
+                        });
+
+                output_file << "sliding window";
+                if (time_windows_->HasUrls())
+                {
+                    output_file <<
+                            ' ' << FormatTimestamp(time_windows_->GetWindowBegin()) <<
+                            " - " << FormatTimestamp(time_windows_->GetWindowEnd());
+                }
+
+                output_file << std::endl;
 
-            if (pattern_[i] == pattern_[k])
+                WriteReport(
+                        time_windows_->GetWindowStatistics(),
+                        time_series_size_of_top_,
+                        output_file);
+                output_file << std::endl << "late urls " <<
+                        time_windows_->GetLateUrlsCount() << std::endl;
+            });
+}
+
+uint64_t UrlStatisticsCollector::UpdateStatistics()
+{
+    if (!is_file_processed_ || followed_files_.empty())
+    {
+        if (input_file_paths_.empty() ||
+                std::find(input_file_paths_.begin(), input_file_paths_.end(), std::string()) !=
+                    input_file_paths_.end())
+        {
+            throw std::invalid_argument(
+                    "UrlStatisticsCollector::UpdateStatistics : Input file path is empty!");
+        }
+
+        ResetStatistics();
+        for (const std::string& input_file_path : input_file_paths_)
+        {
+            if (IsSnapshotFile(input_file_path))
             {
-                k++;
+                throw std::invalid_argument(
+                        "UrlStatisticsCollector::UpdateStatistics : Snapshot can not be followed!");
             }
 
-            prefix_function_result_[i] = k;
+            followed_files_.emplace_back(new FollowedFile(input_file_path));
         }
+
+        is_file_processed_ = true;
     }
 
-private:
-    std::string pattern_;
-    std::vector<int> prefix_function_result_;
-};
-
-using StringSizeTPair = std::pair<std::string, size_t>;
-using StringToCountMap = std::unordered_map<std::string, size_t>;
-
-class UrlStatisticsCollector
-{
-public:
-    /*!
-    * Конструктор.
-    *
-    \param[in] input_file_path Путь к файлу с входными данными.
-    */
-    UrlStatisticsCollector(
-            const std::string& input_file_path)
-        : input_file_path_(input_file_path)
-        , is_file_processed_(false)
-        , domain_symbol_checker_(
-                std::make_shared<DomainSymbolChecker>(
-                    SymbolChecker::CorrectSymbolsSetType::Domain))
-        , path_symbol_checker_(
-                std::make_shared<PathSymbolChecker>(
-                    SymbolChecker::CorrectSymbolsSetType::Path))
-        , substring_searcher_("http")
-        , urls_count_(0)
-        , is_statistics_collected_(false)
-        , size_of_top_rate_(5)
-    {
-    }
-
-    /*!
-    * Устанавливает путь до файла с входными данными.
-    *
-    \param[in] input_file_path Путь к файлу с входными данными.
-    */
-    void SetInputFilePath(
-            const std::string& input_file_path)
-    {
-        if (input_file_path_ != input_file_path)
-        {
-            input_file_path_ = input_file_path;
-            is_file_processed_ = false;
-        }
+    UrlParser url_parser(statistics_, time_windows_.get());
+    uint64_t read_size = 0;
+    for (const auto& followed_file : followed_files_)
+    {
+        read_size += followed_file->ReadAppendedLines(
+                [&url_parser](const StringView block)
+                {
+                    url_parser.ProcessBlock(block);
+                });
     }
 
-    /*!
-    * При необходимости парсит файл с входными данными. Записывает результат
-    в файл, находящийся по указанному пути.
-    *
-    \param[in] output_file_path Путь к файлу для записи результатов.
-    \param[in] size_of_top Количество статистических записей, которое будет выведено.
-    */
-    void WriteStatistics(
-            const std::string& output_file_path,
-            const size_t size_of_top)
+    peak_memory_usage_ = std::max(
+            peak_memory_usage_,
+            statistics_.GetPeakMemoryUsage());
+    return read_size;
+}
+
+void UrlStatisticsCollector::WriteSnapshot(
+        const std::string& snapshot_file_path)
+{
+    EnsureStatisticsCollected();
+
+    if (statistics_.is_approximate)
     {
-        EnsureStatisticsCollected();
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteSnapshot : Snapshot requires exact statistics!");
+    }
 
-        if (output_file_path.empty())
-        {
-            throw std::invalid_argument(
-                    "UrlStatisticsCollector::WriteStatistics : Output file path is empty!");
-        }
+    SnapshotWriter snapshot_writer(snapshot_file_path);
+    WriteSnapshotSection(statistics_.domains, snapshot_writer);
+    snapshot_writer.FinishDomains();
+    WriteSnapshotSection(statistics_.paths, snapshot_writer);
+    snapshot_writer.Finish(statistics_.urls_count);
+}
 
-        std::ofstream output_file(output_file_path);
+void UrlStatisticsCollector::Feed(
+        const char* data,
+        const size_t size)
+{
+    if (!is_file_processed_ || !feed_url_parser_)
+    {
+        ResetStatistics();
+        feed_url_parser_.reset(new UrlParser(statistics_, time_windows_.get()));
+        is_file_processed_ = true;
+    }
 
-        if (!output_file.is_open())
+    const char* const end = data + size;
+    const char* begin = data;
+    if (!feed_carry_.empty())
+    {
+        // Дописываем строку, начатую в предыдущей порции.
+        const char* const line_end =
+                static_cast<const char*>(std::memchr(begin, '\n', size));
+        if (line_end == nullptr)
         {
-            throw std::invalid_argument(
-                    "UrlStatisticsCollector::WriteStatistics : Can not open output file!");
+            feed_carry_.append(begin, size);
+            return;
         }
 
-        output_file <<
-                "total urls " << urls_count_ <<
-                ", domains " << domains_.size() <<
-                ", paths " << paths_.size() << std::endl << std::endl;
+        feed_carry_.append(begin, line_end + 1);
+        feed_url_parser_->ProcessBlock(StringView(feed_carry_.data(), feed_carry_.size()));
+        feed_carry_.clear();
+        begin = line_end + 1;
+    }
+
+    // Целые строки разбираются в буфере вызывающего кода.
+    const char* lines_end = end;
+    while (lines_end != begin && *(lines_end - 1) != '\n')
+    {
+        --lines_end;
+    }
+
+    if (lines_end != begin)
+    {
+        feed_url_parser_->ProcessBlock(StringView(begin, lines_end - begin));
+    }
+
+    feed_carry_.assign(lines_end, end);
+    peak_memory_usage_ = std::max(
+            peak_memory_usage_,
+            statistics_.GetPeakMemoryUsage());
+}
+
+void UrlStatisticsCollector::FinishFeed()
+{
+    if (!feed_url_parser_ || feed_carry_.empty())
+    {
+        return;
+    }
+
+    feed_url_parser_->ProcessBlock(StringView(feed_carry_.data(), feed_carry_.size()));
+    feed_carry_.clear();
+    peak_memory_usage_ = std::max(
+            peak_memory_usage_,
+            statistics_.GetPeakMemoryUsage());
+}
+
+UrlStatisticsSnapshot UrlStatisticsCollector::Snapshot(
+        const size_t size_of_top)
+{
+    EnsureStatisticsCollected();
+
+    UrlStatisticsSnapshot snapshot;
+    snapshot.urls_count = statistics_.urls_count;
+    const bool is_cardinality_estimated =
+            statistics_.domains_cardinality.IsEnabled();
+    if (statistics_.is_approximate)
+    {
+        snapshot.domains_count = statistics_.approximate_domains.size();
+        snapshot.paths_count = statistics_.approximate_paths.size();
+        snapshot.top_domains = SelectTopEntries(
+                statistics_.approximate_domains,
+                size_of_top,
+                statistics_.is_domain_case_folded);
+        snapshot.top_paths = SelectTopEntries(statistics_.approximate_paths, size_of_top);
+    }
+    else
+    {
+        snapshot.domains_count = statistics_.domains.size();
+        snapshot.paths_count = statistics_.paths.size();
+        snapshot.top_domains = SelectTopEntries(
+                statistics_.domains,
+                size_of_top,
+                statistics_.is_domain_case_folded);
+        snapshot.top_paths = SelectTopEntries(statistics_.paths, size_of_top);
+    }
+
+    if (is_cardinality_estimated)
+    {
+        snapshot.domains_count = statistics_.domains_cardinality.Estimate();
+        snapshot.paths_count = statistics_.paths_cardinality.Estimate();
+    }
+
+    return snapshot;
+}
+
+void UrlStatisticsCollector::WriteSnapshotSection(
+        const StringToCountMap& counters,
+        SnapshotWriter& snapshot_writer)
+{
+    std::vector<KeyCountHandle> handles;
+    handles.reserve(counters.size());
+    for (const auto& entry : counters)
+    {
+        handles.push_back(KeyCountHandle{entry.key, entry.count});
+    }
+
+    std::sort(
+            handles.begin(),
+            handles.end(),
+            [](const KeyCountHandle& left, const KeyCountHandle& right)
+            {
+                return CompareBytes(left.key, right.key) < 0;
+            });
+
+    for (const auto& handle : handles)
+    {
+        snapshot_writer.AddRecord(handle.key, handle.count);
+    }
+}
 
-        if (!domains_.empty())
+void UrlStatisticsCollector::WriteOutputFile(
+        const std::string& output_file_path,
+        const std::string& method_name,
+        const std::function<void(std::ostream&)>& write_contents) const
+{
+    // Подмена нужна только в режиме слежения, где результат перезаписывается,
+    // пока его читают. Устройства и каналы всегда пишутся напрямую.
+    const bool is_replaced_atomically =
+            !followed_files_.empty() && IsReplaceableFile(output_file_path);
+    const std::string temporary_file_path = is_replaced_atomically
+            ? CreateTemporaryFile(output_file_path)
+            : output_file_path;
+
+    if (temporary_file_path.empty())
+    {
+        throw std::invalid_argument(
+                method_name + " : Can not open output file!");
+    }
+
+    std::ofstream output_file(temporary_file_path);
+
+    if (!output_file.is_open())
+    {
+        if (is_replaced_atomically)
         {
-            output_file << "top domains" << std::endl;
-            WriteTopNElements(
-                    domains_,
-                    size_of_top,
-                    false,
-                    output_file);
+            std::remove(temporary_file_path.c_str());
         }
 
+        throw std::invalid_argument(
+                method_name + " : Can not open output file!");
+    }
+
+    write_contents(output_file);
+    output_file.close();
+    if (!is_replaced_atomically)
+    {
+        return;
+    }
+
+    if (output_file.fail() ||
+            !ReplaceFileAtomically(temporary_file_path, output_file_path))
+    {
+        std::remove(temporary_file_path.c_str());
+        throw std::invalid_argument(
+                method_name + " : Can not write output file!");
+    }
+}
+
+void UrlStatisticsCollector::WriteReport(
+        const UrlStatistics& statistics,
+        const size_t size_of_top,
+        std::ostream& output_file) const
+{
+    if (statistics.is_approximate)
+    {
+        // Пока счетчики не заполнены, количество ключей в них точное.
+        WriteReport(
+                statistics,
+                statistics.approximate_domains,
+                statistics.approximate_paths,
+                size_of_top,
+                output_file);
+    }
+    else
+    {
+        WriteReport(
+                statistics,
+                statistics.domains,
+                statistics.paths,
+                size_of_top,
+                output_file);
+    }
+}
+
+void UrlStatisticsCollector::WriteBucketReport(
+        const int64_t bucket_begin,
+        const UrlStatistics& statistics,
+        std::ostream& output_file) const
+{
+    output_file << "bucket " << FormatTimestamp(bucket_begin) << std::endl;
+    WriteReport(
+            statistics,
+            time_series_size_of_top_,
+            output_file);
+    output_file << std::endl;
+}
+
+template <typename Container>
+void UrlStatisticsCollector::WriteReport(
+        const UrlStatistics& statistics,
+        const Container& domains,
+        const Container& paths,
+        const size_t size_of_top,
+        std::ostream& output_file) const
+{
+    const bool is_cardinality_estimated =
+            statistics.domains_cardinality.IsEnabled();
+    output_file <<
+            "total urls " << statistics.urls_count <<
+            ", domains " << (is_cardinality_estimated
+                    ? statistics.domains_cardinality.Estimate()
+                    : domains.size()) <<
+            ", paths " << (is_cardinality_estimated
+                    ? statistics.paths_cardinality.Estimate()
+                    : paths.size()) << std::endl << std::endl;
+
+    if (!domains.empty())
+    {
+        output_file << "top domains" << std::endl;
+        WriteTopNElements(
+                domains,
+                size_of_top,
+                statistics.is_domain_case_folded,
+                output_file);
+    }
+
+    output_file << std::endl;
+
+    if (!paths.empty())
+    {
+        output_file << "top paths" << std::endl;
+        WriteTopNElements(
+                paths,
+                size_of_top,
+                false,
+                output_file);
+    }
+
+    if (statistics.is_query_parsed)
+    {
+        output_file << std::endl << "top query keys" << std::endl;
+        WriteTopNElements(
+                statistics.query_keys,
+                size_of_top,
+                false,
+                output_file);
+        output_file << std::endl << "top query parameters" << std::endl;
+        WriteTopNElements(
+                statistics.query_parameters,
+                size_of_top,
+                false,
+                output_file);
+    }
+
+    if (statistics.are_domain_paths_counted)
+    {
+        WriteDomainPathsTop(
+                statistics,
+                size_of_top,
+                output_file);
+    }
+
+    if (domain_level_ != 0 && !domains.empty())
+    {
         output_file << std::endl;
+        WriteDomainLevelTop(
+                domains,
+                size_of_top,
+                output_file);
+    }
 
-        if (!paths_.empty())
-        {
-            output_file << "top paths" << std::endl;
-            WriteTopNElements(
-                    paths_,
-                    size_of_top,
-                    true,
-                    output_file);
-        }
+    if (statistics.is_path_prefix_tree_built)
+    {
+        WritePathPrefixTop(
+                statistics.path_prefixes,
+                size_of_top,
+                output_file);
     }
+}
+
+UrlStatistics UrlStatisticsCollector::CreateStatistics() const
+{
+    UrlStatistics statistics(
+            approximate_top_capacity_,
+            cardinality_precision_,
+            is_domain_case_folded_,
+            IsPathPrefixTreeBuilt(),
+            is_query_parsed_,
+            path_normalization_,
+            are_domain_paths_counted_);
+    statistics.url_filter = url_filter_;
+    return statistics;
+}
 
-private:
-    void CollectStatistics(
-            const std::string& input_file_path)
+void UrlStatisticsCollector::WriteDomainPathsTop(
+        const UrlStatistics& statistics,
+        const size_t size_of_top,
+        std::ostream& output_file) const
+{
+    const std::vector<KeyCountHandle> top_domains = SelectTopEntries(
+            statistics.domains,
+            size_of_top,
+            statistics.is_domain_case_folded);
+
+    // Номер записи домена -> позиция в top_domains.
+    std::vector<size_t> top_positions(statistics.domains.size(), top_domains.size());
+    for (size_t i = 0; i < top_domains.size(); ++i)
+    {
+        top_positions[statistics.domains.Find(top_domains[i].key)] = i;
+    }
+
+    // Пары всех top доменов отбираются за один проход по совместной таблице.
+    std::vector<std::vector<KeyCountHandle>> top_domain_paths(top_domains.size());
+    for (const auto& entry : statistics.domain_paths)
     {
-        if (input_file_path.empty())
+        const size_t position = top_positions[entry.domain_index];
+        if (position != top_domains.size())
         {
-            throw std::invalid_argument(
-                    "UrlStatisticsCollector::WriteStatistics : Input file path is empty!");
+            top_domain_paths[position].push_back(KeyCountHandle{
+                    statistics.paths.GetEntry(entry.path_index).key,
+                    entry.count});
         }
+    }
 
-        std::ifstream input_file(input_file_path);
+    for (size_t i = 0; i < top_domains.size(); ++i)
+    {
+        output_file << std::endl << "top paths on ";
+        output_file.write(top_domains[i].key.Data(), top_domains[i].key.Size());
+        output_file << std::endl;
 
-        if (!input_file.is_open())
+        std::vector<KeyCountHandle>& handles = top_domain_paths[i];
+        const auto top_end = SelectTopN(handles, size_of_top);
+        for (auto current = handles.begin(); current != top_end; ++current)
         {
-            throw std::invalid_argument(
-                    "UrlStatisticsCollector::WriteStatistics : Can not open input file!");
+            output_file << current->count << ' ';
+            output_file.write(current->key.Data(), current->key.Size());
+            output_file << '\n';
         }
+    }
+}
 
-        std::string input_file_line;
-        while (std::getline(
-                input_file,
-                input_file_line))
+void UrlStatisticsCollector::WritePathPrefixTop(
+        const PathPrefixTree& path_prefixes,
+        const size_t size_of_top,
+        std::ostream& output_file) const
+{
+    StringArena prefixes_arena;
+    const auto write_top = [&](std::vector<KeyCountHandle> handles)
+    {
+        const auto top_end = SelectTopN(handles, size_of_top);
+        for (auto current = handles.begin(); current != top_end; ++current)
         {
-            ProcessLine(input_file_line);
+            output_file << current->count << ' ';
+            output_file.write(current->key.Data(), current->key.Size());
+            output_file << '\n';
         }
+    };
 
-        is_file_processed_ = true;
+    if (path_depth_ != 0)
+    {
+        output_file << std::endl << "top paths depth " << path_depth_ << std::endl;
+        write_top(path_prefixes.GetHandles(
+                path_prefixes.GetDepthNodes(path_depth_),
+                prefixes_arena));
     }
 
-    void EnsureStatisticsCollected()
+    if (!path_prefix_.empty())
     {
-        if (!is_file_processed_)
-        {
-            CollectStatistics(input_file_path_);
-        }
+        output_file << std::endl << "top paths under " << path_prefix_ << std::endl;
+        write_top(path_prefixes.GetHandles(
+                path_prefixes.GetChildNodes(StringView(path_prefix_)),
+                prefixes_arena));
     }
+}
+
+bool UrlStatisticsCollector::IsPathPrefixTreeBuilt() const
+{
+    return path_depth_ != 0 || !path_prefix_.empty();
+}
 
-    void WriteTopNElements(
-            const StringToCountMap& container,
-            const size_t size_of_top,
-            const bool is_case_sensitive,
-            std::ofstream& output_file) const
+void UrlStatisticsCollector::CreateTimeWindows()
+{
+    closed_bucket_reports_.clear();
+    if (time_bucket_duration_ == 0)
     {
-        if (container.empty())
-        {
-            return;
-        }
+        time_windows_.reset();
+        return;
+    }
 
-        struct Comp
-        {
-            bool operator()(const StringSizeTPair& left, const StringSizeTPair& right) const
+    time_windows_.reset(new TimeWindowedStatistics(
+            static_cast<int64_t>(time_bucket_duration_),
+            time_windows_count_,
+            [this](const int64_t bucket_begin, const UrlStatistics& statistics)
             {
-                if (left.second != right.second)
+                std::ostringstream bucket_report;
+                WriteBucketReport(bucket_begin, statistics, bucket_report);
+                closed_bucket_reports_.push_back(bucket_report.str());
+                // В режиме слежения корзины закрываются, пока процесс жив,
+                // поэтому хранятся отчеты только последних windows_count.
+                if (!followed_files_.empty() &&
+                        closed_bucket_reports_.size() > time_windows_count_)
                 {
-                    return left.second > right.second;
+                    closed_bucket_reports_.pop_front();
                 }
+            }));
+}
 
-                return ToLowerCase(left.first) < ToLowerCase(right.first);
-                
-            };
-        };
-        
-        std::priority_queue <StringSizeTPair,std::vector<StringSizeTPair>, Comp> top_n_records;
-        StringToCountMap::const_iterator current =
-                container.begin();
-        for (size_t i = 0
-            ; i < std::min(size_of_top, container.size())
-            ; ++i, ++current)
-        {
-            top_n_records.push(*current);
-        }
+void UrlStatisticsCollector::ResetStatistics()
+{
+    followed_files_.clear();
+    feed_url_parser_.reset();
+    feed_carry_.clear();
+    statistics_ = CreateStatistics();
+    CreateTimeWindows();
+    peak_memory_usage_ = 0;
+    telemetry_ = Telemetry();
+    last_telemetry_report_time_ = std::chrono::steady_clock::now();
+}
 
-        for (; current != container.end()
-            ; ++current)
+void UrlStatisticsCollector::CollectStatistics()
+{
+    if (input_file_paths_.empty() ||
+            std::find(input_file_paths_.begin(), input_file_paths_.end(), std::string()) !=
+                input_file_paths_.end())
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::WriteStatistics : Input file path is empty!");
+    }
+
+    // Снимки статистики не разбираются, а добавляются к результату.
+    std::vector<std::string> log_file_paths;
+    std::vector<std::string> snapshot_file_paths;
+    for (const std::string& input_file_path : input_file_paths_)
+    {
+        (IsSnapshotFile(input_file_path) ? snapshot_file_paths : log_file_paths)
+                .push_back(input_file_path);
+    }
+
+    // В снимке домены и пути посчитаны отдельно, а запросы не хранятся, поэтому
+    // ни правила, которые проверяются для URL-а целиком, ни пары (домен, путь),
+    // ни параметры запросов из него не получить.
+    if (!snapshot_file_paths.empty() && url_filter_ != nullptr)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::CollectStatistics : Url filter can not be applied to snapshot!");
+    }
+
+    if (!snapshot_file_paths.empty() &&
+            are_domain_paths_counted_ &&
+            approximate_top_capacity_ == 0)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::CollectStatistics : Domain paths can not be counted from snapshot!");
+    }
+
+    if (!snapshot_file_paths.empty() && is_query_parsed_)
+    {
+        throw std::invalid_argument(
+                "UrlStatisticsCollector::CollectStatistics : Query statistics can not be collected from snapshot!");
+    }
+
+    // Разобранные целиком файлы больше не отслеживаются.
+    ResetStatistics();
+    // Корзины времени заполняются последовательно, поэтому с ними разбор однопоточный.
+    const size_t threads_count = time_windows_ ? 1 : GetEffectiveThreadsCount();
+    if (threads_count == 1 || log_file_paths.empty())
+    {
+        UrlParser url_parser(statistics_, time_windows_.get());
+        for (const std::string& input_file_path : log_file_paths)
         {
-            top_n_records.push(*current);
-            if (top_n_records.size() > size_of_top)
+            const std::unique_ptr<InputSource> input_source =
+                    OpenInputSource(input_file_path, file_read_mode_);
+            StringView block;
+            while (ReadTimedBlock(*input_source, block, statistics_.telemetry))
             {
-                top_n_records.pop();
+                url_parser.ProcessBlock(block);
+                ReportTelemetryProgress([this]
+                {
+                    return GetTelemetry();
+                });
             }
         }
 
-        std::stack<StringSizeTPair> s;
-        while (!top_n_records.empty())
+    }
+    else if (log_file_paths.size() == 1)
+    {
+        const std::unique_ptr<InputSource> input_source =
+                OpenInputSource(log_file_paths.front(), file_read_mode_);
+        CollectStatisticsInParallel(
+                *input_source,
+                threads_count);
+    }
+    else
+    {
+        CollectStatisticsFromFiles(
+                log_file_paths,
+                threads_count);
+    }
+
+    for (const std::string& snapshot_file_path : snapshot_file_paths)
+    {
+        statistics_.AddSnapshot(SnapshotReader(snapshot_file_path));
+    }
+
+    peak_memory_usage_ = std::max(
+            peak_memory_usage_,
+            statistics_.GetPeakMemoryUsage());
+    is_file_processed_ = true;
+}
+
+void UrlStatisticsCollector::CollectStatisticsInParallel(
+        InputSource& input_source,
+        const size_t threads_count)
+{
+    std::vector<UrlStatistics> partial_statistics;
+    for (size_t i = 0; i < threads_count; ++i)
+    {
+        partial_statistics.push_back(CreateStatistics());
+    }
+
+    std::vector<std::unique_ptr<UrlParser>> url_parsers;
+    for (auto& statistics : partial_statistics)
+    {
+        url_parsers.emplace_back(new UrlParser(statistics));
+    }
+
+    // Потоки создаются один раз на весь разбор: блоки сжатых и асинхронно
+    // читаемых файлов невелики, и создание потоков на каждый блок съело бы
+    // выигрыш от параллельности. Поток i разбирает часть i очередного блока.
+    std::vector<StringView> parts;
+    uint64_t block_number = 0;
+    size_t unfinished_workers_count = 0;
+    bool is_input_finished = false;
+    std::exception_ptr worker_exception;
+    std::mutex mutex;
+    std::condition_variable block_condition;
+    std::condition_variable finish_condition;
+
+    const auto work = [&](const size_t worker_index)
+    {
+        uint64_t processed_block_number = 0;
+        for (;;)
         {
-            s.push(top_n_records.top());
-            top_n_records.pop();
+            StringView part;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                block_condition.wait(lock, [&]
+                {
+                    return is_input_finished || block_number != processed_block_number;
+                });
+                if (is_input_finished)
+                {
+                    return;
+                }
+
+                processed_block_number = block_number;
+                if (worker_index < parts.size())
+                {
+                    part = parts[worker_index];
+                }
+            }
+
+            try
+            {
+                if (!part.Empty())
+                {
+                    url_parsers[worker_index]->ProcessBlock(part);
+                }
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!worker_exception)
+                {
+                    worker_exception = std::current_exception();
+                }
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --unfinished_workers_count;
+            }
+
+            finish_condition.notify_one();
         }
+    };
 
-        while (!s.empty())
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads_count; ++i)
+    {
+        workers.emplace_back(work, i);
+    }
+
+    std::exception_ptr reader_exception;
+    try
+    {
+        StringView block;
+        while (ReadTimedBlock(input_source, block, partial_statistics.front().telemetry))
         {
-            auto domain = s.top();
-            output_file << domain.second << " " << domain.first << std::endl;
-            s.pop();
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                parts = SplitBlockByLines(block, threads_count);
+                unfinished_workers_count = workers.size();
+                ++block_number;
+            }
+
+            block_condition.notify_all();
+            if (!parts.empty())
+            {
+                url_parsers.front()->ProcessBlock(parts.front());
+            }
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                finish_condition.wait(lock, [&]
+                {
+                    return unfinished_workers_count == 0;
+                });
+                if (worker_exception)
+                {
+                    break;
+                }
+            }
+
+            ReportTelemetryProgress([this, &partial_statistics]
+            {
+                Telemetry telemetry = telemetry_;
+                for (const auto& statistics : partial_statistics)
+                {
+                    telemetry.Add(statistics.GetTelemetry());
+                }
+
+                return telemetry;
+            });
         }
+    }
+    catch (...)
+    {
+        reader_exception = std::current_exception();
+    }
 
-        //output_file << std::endl;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        is_input_finished = true;
     }
 
-    std::string::size_type IsPrefixCorrect(
-            const std::string& line,
-            std::string::size_type position) const
+    block_condition.notify_all();
+    for (auto& worker : workers)
     {
-        // Часть "http" уже проверена, проверяем оба возможных окончания префикса.
-        if (line.compare(position + 4, 3, "://") == 0)
+        worker.join();
+    }
+
+    if (reader_exception)
+    {
+        std::rethrow_exception(reader_exception);
+    }
+
+    if (worker_exception)
+    {
+        std::rethrow_exception(worker_exception);
+    }
+
+    MergePartialStatistics(partial_statistics);
+}
+
+void UrlStatisticsCollector::CollectStatisticsFromFiles(
+        const std::vector<std::string>& input_file_paths,
+        const size_t threads_count)
+{
+    struct WorkItem
+    {
+        std::string input_file_path;
+        // Отображенный файл, часть которого нужно разобрать.
+        std::shared_ptr<InputSource> mapped_input_source;
+        StringView part;
+    };
+
+    // Части меньше этого размера не выделяются: разбор части должен
+    // заметно превосходить накладные расходы очереди.
+    const size_t minimum_part_size = 16 << 20;
+
+    std::deque<WorkItem> work_items;
+    for (const std::string& input_file_path : input_file_paths)
+    {
+        work_items.push_back(WorkItem{input_file_path, nullptr, StringView()});
+    }
+
+    // Задания в очереди и в работе.
+    size_t unfinished_items_count = work_items.size();
+    std::exception_ptr worker_exception;
+    std::mutex mutex;
+    std::condition_variable condition;
+
+    std::vector<UrlStatistics> partial_statistics;
+    for (size_t i = 0; i < threads_count; ++i)
+    {
+        partial_statistics.push_back(CreateStatistics());
+    }
+
+    // Телеметрия потоков, опубликованная после последнего разобранного ими
+    // блока. Счетчики потока читает только он сам, а отчет собирается из
+    // опубликованных копий под мьютексом.
+    std::vector<Telemetry> published_telemetry(threads_count);
+    const auto report_progress = [&](const UrlStatistics& statistics)
+    {
+        if (!telemetry_handler_)
         {
-            return position + 7;
+            return;
         }
 
-        if (line.compare(position + 4, 4, "s://") == 0)
+        const Telemetry telemetry = statistics.GetTelemetry();
+        std::lock_guard<std::mutex> lock(mutex);
+        published_telemetry[&statistics - partial_statistics.data()] = telemetry;
+        ReportTelemetryProgress([this, &published_telemetry]
         {
-            return position + 8;
-        }
+            Telemetry result = telemetry_;
+            for (const auto& worker_telemetry : published_telemetry)
+            {
+                result.Add(worker_telemetry);
+            }
 
-        return std::string::npos;
-    }
+            return result;
+        });
+    };
 
-    std::string::size_type GetPositionAfterCertainUrlPart(
-            const std::string& line,
-            const std::string::size_type position,
-            const std::shared_ptr<SymbolChecker>& symbol_checker) const
+    const auto work = [&](UrlStatistics& statistics)
     {
-        for (size_t i = position
-            ; i < line.size()
-            ; ++i)
+        UrlParser url_parser(statistics);
+        for (;;)
         {
-            if (!symbol_checker->CheckSymbol(line[i]))
+            WorkItem work_item;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                condition.wait(lock, [&]
+                {
+                    return !work_items.empty() || unfinished_items_count == 0;
+                });
+                if (work_items.empty())
+                {
+                    return;
+                }
+
+                work_item = std::move(work_items.front());
+                work_items.pop_front();
+            }
+
+            try
             {
-                return i;
+                if (work_item.mapped_input_source)
+                {
+                    url_parser.ProcessBlock(work_item.part);
+                    report_progress(statistics);
+                }
+                else
+                {
+                    std::shared_ptr<InputSource> input_source =
+                            OpenInputSource(work_item.input_file_path, file_read_mode_);
+                    StringView block;
+                    if (input_source->IsMemoryMapped() &&
+                            ReadTimedBlock(*input_source, block, statistics.telemetry))
+                    {
+                        const size_t parts_count = std::max<size_t>(
+                                std::min(block.Size() / minimum_part_size, threads_count),
+                                1);
+                        const std::vector<StringView> parts =
+                                SplitBlockByLines(block, parts_count);
+                        {
+                            std::lock_guard<std::mutex> lock(mutex);
+                            for (size_t i = 1; i < parts.size(); ++i)
+                            {
+                                work_items.push_back(
+                                        WorkItem{work_item.input_file_path, input_source, parts[i]});
+                            }
+
+                            unfinished_items_count += parts.size() - 1;
+                        }
+
+                        condition.notify_all();
+                        url_parser.ProcessBlock(parts.front());
+                        report_progress(statistics);
+                    }
+                    else
+                    {
+                        while (ReadTimedBlock(*input_source, block, statistics.telemetry))
+                        {
+                            url_parser.ProcessBlock(block);
+                            report_progress(statistics);
+                        }
+                    }
+                }
             }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!worker_exception)
+                {
+                    worker_exception = std::current_exception();
+                }
+
+                // Оставшиеся задания отменяем.
+                unfinished_items_count -= work_items.size();
+                work_items.clear();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                --unfinished_items_count;
+            }
+
+            condition.notify_all();
         }
+    };
 
-        return line.size();
+    std::vector<std::thread> workers;
+    for (size_t i = 1; i < threads_count; ++i)
+    {
+        workers.emplace_back(work, std::ref(partial_statistics[i]));
     }
 
-    std::string::size_type ParseUrl(
-            const std::string& line,
-            std::string::size_type position)
+    work(partial_statistics.front());
+    for (auto& worker : workers)
     {
-        const std::string::size_type after_prefix_position =
-                IsPrefixCorrect(line, position);
+        worker.join();
+    }
 
-        if (after_prefix_position == std::string::npos)
-        {
-            return position + 4;
-        }
+    if (worker_exception)
+    {
+        std::rethrow_exception(worker_exception);
+    }
 
-        const std::string::size_type after_domain_position =
-                GetPositionAfterCertainUrlPart(
-                    line,
-                    after_prefix_position,
-                    domain_symbol_checker_);
+    MergePartialStatistics(partial_statistics);
+}
 
-        if (after_domain_position == after_prefix_position)
+void UrlStatisticsCollector::MergePartialStatistics(
+        std::vector<UrlStatistics>& partial_statistics)
+{
+    const ScopedStageTimer merge_timer(telemetry_, TelemetryStage::Merge);
+    // До слияния все частичные таблицы живут одновременно.
+    peak_memory_usage_ = 0;
+    for (const auto& statistics : partial_statistics)
+    {
+        peak_memory_usage_ += statistics.GetPeakMemoryUsage();
+    }
+
+    for (size_t step = 1; step < partial_statistics.size(); step *= 2)
+    {
+        std::vector<std::thread> workers;
+        for (size_t i = 0; i + step < partial_statistics.size(); i += 2 * step)
         {
-            return position + 4;
+            workers.emplace_back(
+                    &UrlStatistics::Merge,
+                    &partial_statistics[i],
+                    std::ref(partial_statistics[i + step]));
         }
 
-        const std::string domain(
-                line.begin() + after_prefix_position,
-                line.begin() + after_domain_position);
-        // Домены не чувствительны к регистру, поэтому приводим к нижнему регистру сразу.
-        ++domains_[/*ToLowerCase(*/domain/*)*/];
-        // Обязательные части(префикс и домен) существуют, поэтому теперь можем увеличить счетчик.
-        ++urls_count_;
-
-        const std::string::size_type after_path_position =
-                GetPositionAfterCertainUrlPart(
-                    line,
-                    after_domain_position,
-                    path_symbol_checker_);
-
-        std::string path(
-                line.begin() + after_domain_position,
-                line.begin() + after_path_position);
-
-        if (path.empty())
+        for (auto& worker : workers)
         {
-            path += '/';
+            worker.join();
         }
-        ++paths_[path];
-        
-        return after_path_position;
     }
 
-    void ProcessLine(
-            const std::string& input_file_line)
+    statistics_ = std::move(partial_statistics.front());
+    peak_memory_usage_ = std::max(
+            peak_memory_usage_,
+            statistics_.GetPeakMemoryUsage());
+}
+
+size_t UrlStatisticsCollector::GetEffectiveThreadsCount() const
+{
+    if (threads_count_ != 0)
     {
-        std::string::size_type current_position = 0;
+        return threads_count_;
+    }
 
-        while (current_position != std::string::npos &&
-                current_position < input_file_line.size())
-        {
-            // Ищем первое вхождение префикса URL-а.
-            current_position =
-                    substring_searcher_.Search(
-                        input_file_line,
-                        current_position);
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
 
-            if (current_position == std::string::npos)
-            {
-                break;
-            }
+void UrlStatisticsCollector::ReportTelemetryProgress(
+        const std::function<Telemetry()>& collect_telemetry)
+{
+    if (!telemetry_handler_)
+    {
+        return;
+    }
 
-            current_position =
-                    ParseUrl(input_file_line, current_position);
-        }
+    const auto now = std::chrono::steady_clock::now();
+    if (now - last_telemetry_report_time_ < std::chrono::seconds(telemetry_interval_seconds_))
+    {
+        return;
+    }
+
+    last_telemetry_report_time_ = now;
+    telemetry_handler_(collect_telemetry());
+}
+
+void UrlStatisticsCollector::EnsureStatisticsCollected()
+{
+    if (!is_file_processed_)
+    {
+        CollectStatistics();
+    }
+}
+
+template <typename Container>
+std::vector<KeyCountHandle> UrlStatisticsCollector::SelectTopEntries(
+        const Container& container,
+        const size_t size_of_top,
+        const bool are_keys_case_folded) const
+{
+    // Отбираем ссылки на записи, сами ключи не копируются.
+    std::vector<KeyCountHandle> handles;
+    handles.reserve(container.size());
+    for (const auto& entry : container)
+    {
+        handles.push_back(KeyCountHandle{StringView(entry.key), entry.count});
+    }
+
+    handles.erase(SelectTopN(handles, size_of_top, are_keys_case_folded), handles.end());
+    return handles;
+}
+
+template <typename Container>
+void UrlStatisticsCollector::WriteDomainLevelTop(
+        const Container& domains,
+        const size_t size_of_top,
+        std::ostream& output_file) const
+{
+    // Каждый домен проходится один раз; узлы общих суффиксов разделяются.
+    DomainSuffixTrie domain_suffix_trie;
+    for (const auto& entry : domains)
+    {
+        domain_suffix_trie.Add(StringView(entry.key), entry.count);
     }
 
-private:
-    std::string input_file_path_;
-    bool is_file_processed_;
-    std::shared_ptr<SymbolChecker> domain_symbol_checker_;
-    std::shared_ptr<SymbolChecker> path_symbol_checker_;
-    SubstringSearcher substring_searcher_;
-    size_t urls_count_;
-    bool is_statistics_collected_;
-    size_t size_of_top_rate_;
-    StringToCountMap domains_;
-    StringToCountMap paths_;
-};
+    if (domain_level_ == registrable_domain_level)
+    {
+        output_file << "top registrable domains" << std::endl;
+    }
+    else
+    {
+        output_file << "top domains level " << domain_level_ << std::endl;
+    }
+
+    std::vector<KeyCountHandle> handles = domain_suffix_trie.GetLevel(domain_level_);
+    const auto top_end = SelectTopN(handles, size_of_top);
+    for (auto current = handles.begin(); current != top_end; ++current)
+    {
+        output_file << current->count << ' ';
+        output_file.write(current->key.Data(), current->key.Size());
+        output_file << '\n';
+    }
+}
+
+template <typename Container>
+void UrlStatisticsCollector::WriteTopNElements(
+        const Container& container,
+        const size_t size_of_top,
+        const bool are_keys_case_folded,
+        std::ostream& output_file) const
+{
+    if (container.empty())
+    {
+        return;
+    }
+
+    for (const KeyCountHandle& handle : SelectTopEntries(container, size_of_top, are_keys_case_folded))
+    {
+        output_file << handle.count << ' ';
+        output_file.write(handle.key.Data(), handle.key.Size());
+        output_file << '\n';
+    }
+}
 
 //*************************************************************************//
 // Following lines are necessary to run solution in Unigine test environment.
@@ -580,4 +1422,4 @@ private:
 //     }
 
 //     return 0;
-// }
\ No newline at end of file
+// }
@@ -0,0 +1,476 @@
+﻿#pragma once
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <functional>
+#include <cstdint>
+#include <chrono>
+
+#include "StringView.h"
+#include "UrlScanner.h"
+#include "InputSource.h"
+#include "Counters.h"
+#include "Snapshot.h"
+#include "UrlStatistics.h"
+#include "TimeWindows.h"
+#include "UrlParser.h"
+#include "Telemetry.h"
+#include "DomainSuffixTrie.h"
+#include "PathPrefixTree.h"
+#include "UrlFilter.h"
+
+/*!
+* Результаты на момент вызова UrlStatisticsCollector::Snapshot: общие
+* количества и top-N доменов и путей в порядке отчета. Ключи не копируются:
+* они ссылаются на память сборщика и действительны до следующего изменения
+* статистики (Feed, FinishFeed, повторного разбора входных файлов).
+*/
+struct UrlStatisticsSnapshot
+{
+    size_t urls_count = 0;
+    size_t domains_count = 0;
+    size_t paths_count = 0;
+    std::vector<KeyCountHandle> top_domains;
+    std::vector<KeyCountHandle> top_paths;
+};
+
+/*!
+* Сборщик статистики URL-ов. Данные берутся из входных файлов (пути задаются
+* в конструкторе или SetInputFilePaths) либо передаются порциями через Feed.
+*/
+class UrlStatisticsCollector
+{
+public:
+    /*!
+    * Конструктор для передачи данных через Feed.
+    */
+    UrlStatisticsCollector();
+
+    /*!
+    * Конструктор.
+    *
+    \param[in] input_file_path Путь к файлу с входными данными.
+    */
+    UrlStatisticsCollector(
+            const std::string& input_file_path);
+
+    /*!
+    * Устанавливает путь до файла с входными данными.
+    *
+    \param[in] input_file_path Путь к файлу с входными данными.
+    */
+    void SetInputFilePath(
+            const std::string& input_file_path);
+
+    /*!
+    * Устанавливает пути до нескольких файлов с входными данными. Статистика
+    * собирается по всем файлам вместе.
+    *
+    \param[in] input_file_paths Пути к файлам с входными данными.
+    */
+    void SetInputFilePaths(
+            const std::vector<std::string>& input_file_paths);
+
+    /*!
+    * Устанавливает количество потоков для разбора входных данных.
+    *
+    \param[in] threads_count Количество потоков. 0 - по числу ядер процессора.
+    */
+    void SetThreadsCount(
+            const size_t threads_count);
+
+    /*!
+    * Включает подсчет доменов без учета регистра: "EN.Wikipedia.org" и
+    * "en.wikipedia.org" считаются одним доменом и выводятся в нижнем
+    * регистре. Регистр приводится один раз при разборе.
+    */
+    void SetDomainCaseFolding(
+            const bool is_domain_case_folded);
+
+    /*!
+    * Добавляет в отчет top доменов, свернутых до суффикса заданного уровня:
+    * при уровне 2 "en.wikipedia.org" и "de.wikipedia.org" учитываются как
+    * "wikipedia.org". Все уровни заполняются за один проход по доменам.
+    *
+    \param[in] domain_level Количество меток в суффиксе,
+    * registrable_domain_level - регистрируемый домен (eTLD+1), 0 - не выводить.
+    */
+    void SetDomainLevel(
+            const size_t domain_level);
+
+    /*!
+    * Добавляет в отчет top префиксов путей глубины path_depth: при глубине 1
+    * - каталоги первого уровня ("/wiki/") и файлы в корне ("/favicon.ico"),
+    * при глубине 2 - "/w/index.php", "/wiki/Main_Page" и т.д. Для этого при
+    * разборе строится дерево префиксов путей.
+    *
+    \param[in] path_depth Глубина префиксов. 0 - не выводить.
+    */
+    void SetPathDepth(
+            const size_t path_depth);
+
+    /*!
+    * Добавляет в отчет top префиксов, непосредственно продолжающих
+    * path_prefix (например, страниц и подкаталогов "/wiki/"). Префикс
+    * должен заканчиваться на '/' или совпадать с путем целиком.
+    *
+    \param[in] path_prefix Префикс. Пустая строка - не выводить.
+    */
+    void SetPathPrefix(
+            const std::string& path_prefix);
+
+    /*!
+    * Включает разбор строк запроса: после top путей в отчет добавляются
+    * top ключей параметров ("title") и пар "ключ=значение"
+    * ("action=edit"). Запрос разбирается в том же проходе, что и URL;
+    * параметры считаются точно и в снимки не сохраняются, поэтому со
+    * снимками среди входных файлов сбор статистики завершится исключением.
+    */
+    void SetQueryStatistics(
+            const bool is_query_parsed);
+
+    /*!
+    * Включает нормализацию путей при разборе: "/a/./b", "/a//b" и "/a%2Fb"
+    * учитываются как "/a/b". По умолчанию пути учитываются как есть.
+    */
+    void SetPathNormalization(
+            const PathNormalization path_normalization);
+
+    /*!
+    * Добавляет в отчет top путей для каждого из top доменов ("top paths on
+    * en.wikipedia.org"). Пары (домен, путь) считаются в том же проходе по
+    * номерам записей доменов и путей. В приближенном режиме не выводится.
+    * Снимки пар не содержат, поэтому вместе с ними сбор статистики
+    * завершится исключением.
+    */
+    void SetDomainPathCounting(
+            const bool are_domain_paths_counted);
+
+    /*!
+    * Устанавливает фильтр: учитываются только URL-ы, прошедшие его правила.
+    * Правила проверяются при разборе до обновления счетчиков. Пустой фильтр
+    * отключает фильтрацию. Со снимками среди входных файлов фильтр не
+    * используется: сбор статистики завершится исключением.
+    */
+    void SetUrlFilter(
+            UrlFilter url_filter);
+
+    /*!
+    * Устанавливает способ чтения несжатых обычных файлов. На результат не
+    * влияет. По умолчанию файлы отображаются в память.
+    */
+    void SetFileReadMode(
+            const FileReadMode file_read_mode);
+
+    /*!
+    * Включает приближенный режим: вместо точных таблиц для доменов и путей
+    * используются счетчики Space-Saving ограниченной емкости.
+    *
+    \param[in] approximate_top_capacity Количество отслеживаемых доменов и
+    * путей. 0 - точный подсчет.
+    */
+    void SetApproximateTopCapacity(
+            const size_t approximate_top_capacity);
+
+    /*!
+    * Включает оценку количества различных доменов и путей алгоритмом
+    * HyperLogLog. Вместе с приближенным режимом позволяет построить отчет
+    * в памяти, не зависящей от входных данных.
+    *
+    \param[in] cardinality_precision Точность оценки (4..18), память на
+    * оценку - 2^cardinality_precision байт. 0 - точный подсчет по таблицам.
+    */
+    void SetCardinalityPrecision(
+            const size_t cardinality_precision);
+
+    /*!
+    * Возвращает наибольшую возможную переоценку счетчика домена в
+    * приближенном режиме. В точном режиме равна 0.
+    */
+    size_t GetDomainsMaximumError();
+
+    /*!
+    * Возвращает наибольшую возможную переоценку счетчика пути в
+    * приближенном режиме. В точном режиме равна 0.
+    */
+    size_t GetPathsMaximumError();
+
+    /*!
+    * Возвращает наибольший объем памяти в байтах, занимавшийся таблицами
+    * доменов и путей при последнем разборе входных данных.
+    */
+    size_t GetPeakMemoryUsage() const;
+
+    /*!
+    * Возвращает телеметрию последнего сбора статистики: счетчики разбора,
+    * таблиц и время этапов. Без URL_STATISTICS_TELEMETRY счетчики нулевые.
+    */
+    Telemetry GetTelemetry() const;
+
+    /*!
+    * Задает обработчик промежуточной телеметрии. Во время разбора он
+    * вызывается между блоками входных данных не чаще раза в interval_seconds
+    * секунд. При разборе нескольких файлов пулом потоков промежуточная
+    * телеметрия не выдается.
+    *
+    \param[in] telemetry_handler Обработчик. Пустой - не вызывать.
+    \param[in] interval_seconds Интервал между вызовами.
+    */
+    void SetTelemetryHandler(
+            const std::function<void(const Telemetry&)>& telemetry_handler,
+            const size_t interval_seconds);
+
+    /*!
+    * При необходимости парсит файл с входными данными. Записывает результат
+    в файл, находящийся по указанному пути.
+    *
+    \param[in] output_file_path Путь к файлу для записи результатов.
+    \param[in] size_of_top Количество статистических записей, которое будет выведено.
+    */
+    void WriteStatistics(
+            const std::string& output_file_path,
+            const size_t size_of_top);
+
+    /*!
+    * Включает статистику по интервалам времени. Время берется из начала
+    * каждой строки (ISO 8601 или Common Log Format), строки без времени в
+    * нее не попадают. Входные данные разбираются в одном потоке, так как
+    * корзины заполняются в порядке времени.
+    *
+    \param[in] bucket_duration_seconds Длительность корзины в секундах
+    * (60 - минута, 3600 - час). 0 - статистика по времени не собирается.
+    \param[in] windows_count Количество хранимых корзин (ширина скользящего окна).
+    \param[in] size_of_top Количество записей в отчете каждой корзины.
+    */
+    void SetTimeWindows(
+            const size_t bucket_duration_seconds,
+            const size_t windows_count,
+            const size_t size_of_top);
+
+    /*!
+    * При необходимости парсит файл с входными данными. Записывает отчеты
+    * по каждой корзине времени в порядке времени, а затем отчет по
+    * скользящему окну из последних корзин. В режиме слежения из закрытых
+    * корзин выводятся только последние windows_count.
+    *
+    \param[in] output_file_path Путь к файлу для записи результатов.
+    */
+    void WriteTimeSeries(
+            const std::string& output_file_path);
+
+    /*!
+    * Режим слежения за растущими входными файлами: разбирает только строки,
+    * дописанные с предыдущего вызова. При первом вызове (или после смены
+    * входных файлов) файлы разбираются с начала. Сжатые файлы и снимки
+    * не поддерживаются.
+    *
+    \return Количество прочитанных байтов.
+    */
+    uint64_t UpdateStatistics();
+
+    /*!
+    * При необходимости парсит файл с входными данными. Записывает снимок
+    * статистики, который можно загрузить вместо входных данных или слить с
+    * другими снимками. Доступно только при точном подсчете.
+    *
+    \param[in] snapshot_file_path Путь к файлу снимка.
+    */
+    void WriteSnapshot(
+            const std::string& snapshot_file_path);
+
+    /*!
+    * Разбирает очередную порцию входных данных, например буфер, уже
+    * находящийся в памяти процесса. Строка может быть разбита между
+    * порциями: ее начало откладывается до получения перевода строки, целые
+    * строки разбираются прямо в переданном буфере без копирования.
+    * Разбор идет в вызывающем потоке. При первом вызове (или после смены
+    * настроек) статистика собирается заново, поэтому настройки задаются до
+    * передачи данных.
+    *
+    \param[in] data Данные.
+    \param[in] size Размер данных в байтах.
+    */
+    void Feed(
+            const char* data,
+            const size_t size);
+
+    /*!
+    * Разбирает отложенную последнюю строку без перевода строки. Вызывается,
+    * когда поток данных закончился.
+    */
+    void FinishFeed();
+
+    /*!
+    * При необходимости парсит файл с входными данными. Возвращает текущие
+    * результаты без копирования ключей.
+    *
+    \param[in] size_of_top Количество доменов и путей в top-N.
+    */
+    UrlStatisticsSnapshot Snapshot(
+            const size_t size_of_top);
+
+private:
+    static void WriteSnapshotSection(
+            const StringToCountMap& counters,
+            SnapshotWriter& snapshot_writer);
+
+    /*!
+    * Пишет результат в файл. В режиме слежения результат пишется во
+    * временный файл с уникальным именем, которым затем целиком подменяется
+    * прежний, чтобы читатели не видели его частично.
+    */
+    void WriteOutputFile(
+            const std::string& output_file_path,
+            const std::string& method_name,
+            const std::function<void(std::ostream&)>& write_contents) const;
+
+    void WriteReport(
+            const UrlStatistics& statistics,
+            const size_t size_of_top,
+            std::ostream& output_file) const;
+
+    void WriteBucketReport(
+            const int64_t bucket_begin,
+            const UrlStatistics& statistics,
+            std::ostream& output_file) const;
+
+    template <typename Container>
+    void WriteReport(
+            const UrlStatistics& statistics,
+            const Container& domains,
+            const Container& paths,
+            const size_t size_of_top,
+            std::ostream& output_file) const;
+
+    UrlStatistics CreateStatistics() const;
+
+    void CreateTimeWindows();
+
+    /*!
+    * Начинает сбор статистики заново: отслеживаемые файлы и отложенная
+    * строка Feed сбрасываются.
+    */
+    void ResetStatistics();
+
+    void CollectStatistics();
+
+    /*!
+    * Каждый поток разбирает свою часть блока в собственную статистику,
+    * затем статистики попарно сливаются деревом.
+    */
+    void CollectStatisticsInParallel(
+            InputSource& input_source,
+            const size_t threads_count);
+
+    /*!
+    * Обрабатывает несколько файлов пулом потоков с общей очередью заданий.
+    * Заданием служит файл или часть отображенного в память файла: открыв
+    * большой файл, поток делит его на части и ставит их в очередь, чтобы
+    * один большой файл не обрабатывался дольше всех остальных.
+    */
+    void CollectStatisticsFromFiles(
+            const std::vector<std::string>& input_file_paths,
+            const size_t threads_count);
+
+    /*!
+    * Сливает частичные статистики попарно деревом, пары на каждом уровне
+    * сливаются параллельно. Результат записывается в statistics_.
+    */
+    void MergePartialStatistics(
+            std::vector<UrlStatistics>& partial_statistics);
+
+    size_t GetEffectiveThreadsCount() const;
+
+    /*!
+    * Вызывает обработчик промежуточной телеметрии, если прошел интервал.
+    *
+    \param[in] collect_telemetry Возвращает текущую телеметрию разбора.
+    */
+    void ReportTelemetryProgress(
+            const std::function<Telemetry()>& collect_telemetry);
+
+    void EnsureStatisticsCollected();
+
+    /*!
+    * Отбирает size_of_top записей с наибольшим рангом в порядке отчета.
+    * Ключи не копируются. Ключи, уже приведенные к нижнему регистру,
+    * сравниваются побайтово, без повторного приведения.
+    */
+    template <typename Container>
+    std::vector<KeyCountHandle> SelectTopEntries(
+            const Container& container,
+            const size_t size_of_top,
+            const bool are_keys_case_folded = false) const;
+
+    /*!
+    * Пишет top доменов, свернутых до уровня domain_level_.
+    */
+    template <typename Container>
+    void WriteDomainLevelTop(
+            const Container& domains,
+            const size_t size_of_top,
+            std::ostream& output_file) const;
+
+    /*!
+    * Пишет top префиксов путей по глубине и по заданному префиксу.
+    */
+    void WritePathPrefixTop(
+            const PathPrefixTree& path_prefixes,
+            const size_t size_of_top,
+            std::ostream& output_file) const;
+
+    bool IsPathPrefixTreeBuilt() const;
+
+    /*!
+    * Пишет top путей для каждого из size_of_top доменов с наибольшим рангом.
+    */
+    void WriteDomainPathsTop(
+            const UrlStatistics& statistics,
+            const size_t size_of_top,
+            std::ostream& output_file) const;
+
+    template <typename Container>
+    void WriteTopNElements(
+            const Container& container,
+            const size_t size_of_top,
+            const bool are_keys_case_folded,
+            std::ostream& output_file) const;
+
+private:
+    std::vector<std::string> input_file_paths_;
+    bool is_file_processed_;
+    size_t threads_count_;
+    FileReadMode file_read_mode_;
+    bool is_domain_case_folded_;
+    size_t domain_level_;
+    size_t path_depth_;
+    std::string path_prefix_;
+    bool is_query_parsed_;
+    PathNormalization path_normalization_;
+    bool are_domain_paths_counted_;
+    std::shared_ptr<const UrlFilter> url_filter_;
+    size_t approximate_top_capacity_;
+    size_t cardinality_precision_;
+    size_t peak_memory_usage_;
+    bool is_statistics_collected_;
+    size_t size_of_top_rate_;
+    UrlStatistics statistics_;
+    std::vector<std::unique_ptr<FollowedFile>> followed_files_;
+    size_t time_bucket_duration_;
+    size_t time_windows_count_;
+    size_t time_series_size_of_top_;
+    std::unique_ptr<TimeWindowedStatistics> time_windows_;
+    // Отчеты закрытых корзин. Сами корзины к этому моменту освобождены.
+    std::deque<std::string> closed_bucket_reports_;
+    // Разбор данных, переданных через Feed, и начало незавершенной строки.
+    std::unique_ptr<UrlParser> feed_url_parser_;
+    std::string feed_carry_;
+    // Время этапов, выполняемых вне разбора (слияние, отчет).
+    Telemetry telemetry_;
+    std::function<void(const Telemetry&)> telemetry_handler_;
+    size_t telemetry_interval_seconds_;
+    std::chrono::steady_clock::time_point last_telemetry_report_time_;
+};